@@ -0,0 +1,150 @@
+#pragma once
+/*
+  Host stand-in for the Arduino core, used by env:native.
+  - Serial is backed by in-memory RX/TX buffers, optionally capped like the
+    AVR core's rings (see native:: helpers below).
+  - millis()/micros() follow the host steady clock; delay() advances a virtual
+    offset instead of sleeping so benchmarks are not dominated by pin pulses.
+  - Pins are recorded, not driven; analogRead() draws from a pluggable source.
+*/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LED_BUILTIN 13
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define NUM_PINS 20
+
+#define DEC 10
+#define HEX 16
+
+#define noInterrupts()
+#define interrupts()
+
+#define PROGMEM
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define strlen_P strlen
+#define memcmp_P memcmp
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// avr/boot.h stand-in: the serial number bytes of the signature row (0x0E..0x17)
+// come from native::setChipSerial(), every other address reads 0xFF.
+uint8_t boot_signature_byte_get(uint16_t addr);
+
+// ----------------------------------------------------
+// Print / Serial
+// ----------------------------------------------------
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  size_t write(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) write(buf[i]);
+    return len;
+  }
+  size_t write(const char *s) { return write(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T &v, int base) { size_t n = print(v, base); return n + println(); }
+};
+
+class NativeSerial : public Print {
+public:
+  void begin(unsigned long baud) { baud_ = baud; }
+  void end() {}
+  void setTimeout(unsigned long ms) { timeoutMs_ = ms; }
+  int available();
+  int read();
+  int peek();
+  size_t readBytes(char *buf, size_t len);
+  String readStringUntil(char terminator);
+  void flush() {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int availableForWrite();
+  operator bool() const { return true; }
+
+  unsigned long baud() const { return baud_; }
+
+private:
+  unsigned long baud_ = 0;
+  unsigned long timeoutMs_ = 1000;
+};
+
+extern NativeSerial Serial;
+
+void setup();
+void loop();
+
+// ----------------------------------------------------
+// Host-side hooks for tests, benchmarks and tools
+// ----------------------------------------------------
+namespace native {
+void serialFeed(const char *data, size_t len);
+inline void serialFeed(const char *line) { serialFeed(line, strlen(line)); }
+size_t serialPending();
+// Caps Serial RX like the AVR core's ring buffer (0 = unbounded); excess bytes are dropped.
+void setSerialRxCapacity(size_t bytes);
+size_t serialDropped();
+// Called whenever the sketch polls Serial.available(), so a driver can keep
+// delivering bytes at wire speed while loop() is busy (as the RX interrupt would).
+void setSerialRxSource(void (*source)());
+std::string serialTakeOutput();
+std::string serialTakeOutput(size_t maxBytes);      // oldest bytes first
+size_t serialOutputPending();
+void serialClearOutput();
+// Caps Serial TX like the AVR core's ring buffer (0 = unbounded). Once it is
+// full, Serial.write() calls the sink until it has taken some output.
+void setSerialTxCapacity(size_t bytes);
+// Called whenever the sketch finds the TX ring full, writing or polling
+// Serial.availableForWrite(), so a driver can move bytes to the wire (as the
+// TX interrupt would).
+void setSerialTxSink(void (*sink)());
+
+uint8_t pinState(uint8_t pin);
+void setAnalogSource(int (*source)(uint8_t pin));
+void advanceMicros(unsigned long us);
+// Up to 10 serial number bytes, so emulated controllers report distinct device ids.
+void setChipSerial(const uint8_t *bytes, size_t len);
+}
@@ -0,0 +1,272 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <chrono>
+#include <deque>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#if !defined(PIO_UNIT_TESTING) && !defined(ARDUINO_NATIVE_NO_MAIN) && !defined(ARDUINO_NATIVE_PTY)
+#include <poll.h>
+#endif
+
+NativeSerial Serial;
+EEPROMClass EEPROM;
+
+namespace {
+std::deque<char> rxQueue;
+size_t rxCapacity = 0;
+size_t rxDropped = 0;
+void (*rxSource)() = nullptr;
+std::string txBuffer;
+size_t txCapacity = 0;
+void (*txSink)() = nullptr;
+uint8_t pins[NUM_PINS];
+uint8_t chipSerial[10];
+unsigned long virtualMicros = 0;
+const auto bootTime = std::chrono::steady_clock::now();
+
+uint8_t eepromCells[NATIVE_EEPROM_SIZE];
+bool eepromInit = false;
+native::EepromStats stats = {0, 0, 0};
+int eepromFd = -1;                     // backing image, -1 if none
+unsigned long writeLatency = 0;
+unsigned long lastWriteAt = 0;
+void (*writeHook)(int idx, uint8_t val) = nullptr;
+
+uint8_t *cells() {
+  if (!eepromInit) {
+    memset(eepromCells, 0xFF, sizeof(eepromCells)); // erased AVR EEPROM reads 0xFF
+    eepromInit = true;
+  }
+  return eepromCells;
+}
+
+int defaultAnalog(uint8_t) { return rand() & 0x3FF; }
+int (*analogSource)(uint8_t) = defaultAnalog;
+}
+
+// ----------------------------------------------------
+// Time & pins
+// ----------------------------------------------------
+unsigned long micros() {
+  auto elapsed = std::chrono::steady_clock::now() - bootTime;
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + virtualMicros;
+}
+
+unsigned long millis() { return micros() / 1000UL; }
+void delay(unsigned long ms) { virtualMicros += ms * 1000UL; }
+void delayMicroseconds(unsigned int us) { virtualMicros += us; }
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t val) { if (pin < NUM_PINS) pins[pin] = val ? HIGH : LOW; }
+int digitalRead(uint8_t pin) { return pin < NUM_PINS ? pins[pin] : LOW; }
+int analogRead(uint8_t pin) { return analogSource(pin); }
+
+uint8_t boot_signature_byte_get(uint16_t addr) {
+  return addr >= 0x0E && addr < 0x0E + sizeof(chipSerial) ? chipSerial[addr - 0x0E] : 0xFF;
+}
+
+// ----------------------------------------------------
+// Print / Serial
+// ----------------------------------------------------
+size_t Print::print(long v, int base) {
+  if (v < 0 && base == DEC) {
+    size_t n = print('-');
+    return n + print((unsigned long)(-v), base);
+  }
+  return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char *p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    unsigned long digit = v % base;
+    *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    v /= base;
+  } while (v);
+  return write(p);
+}
+
+int NativeSerial::available() {
+  if (rxSource) rxSource();
+  return (int)rxQueue.size();
+}
+
+int NativeSerial::read() {
+  if (rxQueue.empty()) return -1;
+  char c = rxQueue.front();
+  rxQueue.pop_front();
+  return (uint8_t)c;
+}
+
+int NativeSerial::peek() { return rxQueue.empty() ? -1 : (uint8_t)rxQueue.front(); }
+
+size_t NativeSerial::readBytes(char *buf, size_t len) {
+  size_t n = 0;
+  while (n < len && !rxQueue.empty()) buf[n++] = (char)read();
+  return n;
+}
+
+// The host queue never refills mid-call, so the stream timeout collapses to
+// "stop when the buffered bytes run out".
+String NativeSerial::readStringUntil(char terminator) {
+  String out;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) out += (char)c;
+  return out;
+}
+
+// A full TX ring waits for the sink to drain it, as HardwareSerial waits for the
+// UART; without a sink (or capacity) the buffer just grows.
+size_t NativeSerial::write(uint8_t c) {
+  while (txCapacity && txSink && txBuffer.size() >= txCapacity) txSink();
+  txBuffer.push_back((char)c);
+  return 1;
+}
+
+int NativeSerial::availableForWrite() {
+  if (!txCapacity) return 63;           // unbounded: report an AVR-sized ring
+  if (txSink && txBuffer.size() >= txCapacity) txSink();
+  return txBuffer.size() < txCapacity ? (int)(txCapacity - txBuffer.size()) : 0;
+}
+
+// ----------------------------------------------------
+// EEPROM
+// ----------------------------------------------------
+uint8_t EEPROMClass::read(int idx) const {
+  stats.reads++;
+  return (idx >= 0 && idx < NATIVE_EEPROM_SIZE) ? cells()[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+  if (idx < 0 || idx >= NATIVE_EEPROM_SIZE) return;
+  if (writeHook) writeHook(idx, val);
+  cells()[idx] = val;
+  stats.cellsWritten++;
+  if (eepromFd >= 0 && pwrite(eepromFd, &val, 1, idx) != 1) perror("eeprom image");
+  lastWriteAt = micros();
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+  if (idx < 0 || idx >= NATIVE_EEPROM_SIZE) return;
+  if (cells()[idx] == val) {
+    stats.cellsSkipped++;
+    return;
+  }
+  write(idx, val);
+}
+
+bool eeprom_is_ready() {
+  return !writeLatency || micros() - lastWriteAt >= writeLatency;
+}
+
+// ----------------------------------------------------
+// Host hooks
+// ----------------------------------------------------
+namespace native {
+void serialFeed(const char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (rxCapacity && rxQueue.size() >= rxCapacity) rxDropped++;
+    else rxQueue.push_back(data[i]);
+  }
+}
+
+size_t serialPending() { return rxQueue.size(); }
+void setSerialRxCapacity(size_t bytes) { rxCapacity = bytes; }
+size_t serialDropped() { return rxDropped; }
+void setSerialRxSource(void (*source)()) { rxSource = source; }
+
+std::string serialTakeOutput() {
+  std::string out;
+  out.swap(txBuffer);
+  return out;
+}
+
+std::string serialTakeOutput(size_t maxBytes) {
+  if (maxBytes >= txBuffer.size()) return serialTakeOutput();
+  std::string out = txBuffer.substr(0, maxBytes);
+  txBuffer.erase(0, maxBytes);
+  return out;
+}
+
+size_t serialOutputPending() { return txBuffer.size(); }
+void setSerialTxCapacity(size_t bytes) { txCapacity = bytes; }
+void setSerialTxSink(void (*sink)()) { txSink = sink; }
+
+void serialClearOutput() { txBuffer.clear(); }
+
+uint8_t pinState(uint8_t pin) { return pin < NUM_PINS ? pins[pin] : LOW; }
+void setAnalogSource(int (*source)(uint8_t)) { analogSource = source ? source : defaultAnalog; }
+void advanceMicros(unsigned long us) { virtualMicros += us; }
+
+void setChipSerial(const uint8_t *bytes, size_t len) {
+  memset(chipSerial, 0, sizeof(chipSerial));
+  memcpy(chipSerial, bytes, len < sizeof(chipSerial) ? len : sizeof(chipSerial));
+}
+
+const EepromStats &eepromStats() { return stats; }
+void eepromResetStats() { stats = EepromStats{0, 0, 0}; }
+void eepromFill(uint8_t val) { memset(cells(), val, NATIVE_EEPROM_SIZE); }
+uint8_t *eepromData() { return cells(); }
+
+bool eepromAttachFile(const char *path) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+  uint8_t *data = cells();
+  ssize_t n = pread(fd, data, NATIVE_EEPROM_SIZE, 0);
+  if (n < 0) n = 0;
+  if (n < NATIVE_EEPROM_SIZE) {
+    memset(data + n, 0xFF, NATIVE_EEPROM_SIZE - n);
+    if (pwrite(fd, data + n, NATIVE_EEPROM_SIZE - n, n) != NATIVE_EEPROM_SIZE - n) {
+      close(fd);
+      return false;
+    }
+  }
+  if (eepromFd >= 0) close(eepromFd);
+  eepromFd = fd;
+  return true;
+}
+
+void setEepromWriteLatency(unsigned long us) { writeLatency = us; }
+void setEepromWriteHook(void (*hook)(int idx, uint8_t val)) { writeHook = hook; }
+}
+
+// ----------------------------------------------------
+// Host entry point: stdin -> Serial RX, Serial TX -> stdout
+// (tools that drive setup()/loop() themselves define ARDUINO_NATIVE_NO_MAIN;
+// ARDUINO_NATIVE_PTY selects the pseudo-terminal entry point in NativePty.cpp)
+// ----------------------------------------------------
+#if !defined(PIO_UNIT_TESTING) && !defined(ARDUINO_NATIVE_NO_MAIN) && !defined(ARDUINO_NATIVE_PTY)
+int main() {
+  setup();
+  bool inputOpen = true;
+  int idlePasses = 0;
+  for (;;) {
+    if (inputOpen) {
+      struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+      if (poll(&pfd, 1, rxQueue.empty() ? 10 : 0) > 0) {
+        char chunk[256];
+        ssize_t n = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+        if (n > 0) native::serialFeed(chunk, (size_t)n);
+        else inputOpen = false;
+      }
+    }
+
+    loop();
+
+    std::string out = native::serialTakeOutput();
+    if (!out.empty()) {
+      fwrite(out.data(), 1, out.size(), stdout);
+      fflush(stdout);
+    }
+    // A few idle passes let the sketch drain lines it has already buffered.
+    if (inputOpen || !rxQueue.empty()) idlePasses = 0;
+    else if (++idlePasses > 16) return 0;
+  }
+}
+#endif
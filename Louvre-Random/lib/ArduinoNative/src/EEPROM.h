@@ -0,0 +1,61 @@
+#pragma once
+/*
+  Host stand-in for the AVR EEPROM library.
+  Mirrors its semantics (write() always programs the cell, update()/put() skip
+  unchanged bytes) and counts programmed cells so benchmarks can report wear.
+  Cells can be backed by an image file, and writes can be given the AVR's
+  completion latency, polled through avr-libc's eeprom_is_ready().
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef NATIVE_EEPROM_SIZE
+#define NATIVE_EEPROM_SIZE 1024
+#endif
+
+#define E2END (NATIVE_EEPROM_SIZE - 1)
+
+class EEPROMClass {
+public:
+  uint8_t read(int idx) const;
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);
+  uint16_t length() const { return NATIVE_EEPROM_SIZE; }
+
+  template <typename T> T &get(int idx, T &t) const {
+    uint8_t *ptr = reinterpret_cast<uint8_t *>(&t);
+    for (size_t i = 0; i < sizeof(T); i++) ptr[i] = read(idx + (int)i);
+    return t;
+  }
+
+  template <typename T> const T &put(int idx, const T &t) {
+    const uint8_t *ptr = reinterpret_cast<const uint8_t *>(&t);
+    for (size_t i = 0; i < sizeof(T); i++) update(idx + (int)i, ptr[i]);
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+// False until the last write's simulated latency has elapsed (always true by default).
+bool eeprom_is_ready();
+
+namespace native {
+struct EepromStats {
+  unsigned long reads;          // cells read
+  unsigned long cellsWritten;   // cells actually programmed
+  unsigned long cellsSkipped;   // update() calls that matched the stored value
+};
+
+const EepromStats &eepromStats();
+void eepromResetStats();
+void eepromFill(uint8_t val);
+uint8_t *eepromData();
+// Loads the cells from path (created erased if missing) and writes every change through.
+bool eepromAttachFile(const char *path);
+void setEepromWriteLatency(unsigned long us);
+// Called with each cell about to be programmed, in order, so a test can replay
+// a power cut after any prefix of the writes.
+void setEepromWriteHook(void (*hook)(int idx, uint8_t val));
+}
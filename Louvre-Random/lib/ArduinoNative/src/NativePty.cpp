@@ -0,0 +1,203 @@
+/*
+  Pseudo-terminal entry point for the host build (env:emulator). The sketch
+  runs unmodified behind a PTY, so serial clients such as
+  backend/utils/escrowBridge.js open it like a board on /dev/ttyACM0:
+
+    program [--link PATH] [--eeprom FILE] [--baud N] [--write-us N] [--rx-buffer N]
+            [--tx-buffer N] [--id HEX]
+
+  --link      symlink PATH to the PTY so clients get a stable device name
+  --eeprom    back the EEPROM with an image file that survives restarts
+  --baud      pace both directions at N/10 bytes per second (default 115200,
+              0 = unthrottled)
+  --write-us  completion latency of one EEPROM cell write (an Uno takes ~3300)
+  --rx-buffer Serial RX ring size (default 64 like the AVR core, unbounded with
+              --baud 0); bytes that arrive while it is full are dropped, as in
+              a UART overrun
+  --tx-buffer Serial TX ring size (default 64, unbounded with --baud 0); a
+              write into a full ring waits for the wire while RX keeps arriving
+  --id        chip serial number (up to 20 hex digits) that INFO reports, to
+              tell several emulated controllers apart
+*/
+#ifdef ARDUINO_NATIVE_PTY
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+volatile sig_atomic_t stopRequested = 0;
+int master = -1;
+double bytesPerMicro = 0;               // 0 = unthrottled
+// Most line time either direction banks. A host process that was descheduled
+// for a few ms would otherwise get that many bytes at once and overrun the RX
+// ring, which a board that never stopped reading would not.
+const double MAX_BURST = 16;
+double rxBudget = 0;
+unsigned long rxTick;
+bool rxIdle = true;                     // last delivery found no bytes waiting
+double txBudget = 0;
+unsigned long txTick;
+std::string tx;                         // taken from the TX ring, not yet accepted by the PTY
+
+void onSignal(int) { stopRequested = 1; }
+
+// Moves bytes from the PTY into Serial RX at wire speed. It is also the RX
+// source, so bytes keep arriving while the sketch waits inside loop() and
+// overrun the RX ring only when the sketch really stops reading. A UART earns
+// no budget while the line is idle.
+void deliverRx() {
+  unsigned long now = micros();
+  char chunk[256];
+  size_t want = sizeof(chunk);
+  if (bytesPerMicro) {
+    rxBudget += (now - rxTick) * bytesPerMicro;
+    if (rxBudget > MAX_BURST) rxBudget = MAX_BURST;
+    want = (size_t)rxBudget;
+  }
+  rxTick = now;
+  if (!want) return;
+  ssize_t got = read(master, chunk, want);
+  if (got > 0) {
+    native::serialFeed(chunk, (size_t)got);
+    rxBudget -= got;
+  }
+  rxIdle = got <= 0;
+  if (got < (ssize_t)want) rxBudget = 0;
+}
+
+// Moves bytes from Serial TX to the PTY at wire speed. It is also the TX sink,
+// so a sketch writing into a full ring waits for the wire as on a board while
+// RX keeps arriving. Like RX, the line earns no budget while idle.
+void deliverTx() {
+  deliverRx();
+  unsigned long now = micros();
+  size_t allowed = (size_t)-1;
+  if (bytesPerMicro) {
+    txBudget += (now - txTick) * bytesPerMicro;
+    if (txBudget > MAX_BURST) txBudget = MAX_BURST;
+    allowed = (size_t)txBudget;
+  }
+  txTick = now;
+  if (tx.size() < allowed) tx += native::serialTakeOutput(allowed - tx.size());
+  if (tx.empty()) {
+    if (!native::serialOutputPending()) txBudget = 0;
+    return;
+  }
+  ssize_t sent = write(master, tx.data(), tx.size() < allowed ? tx.size() : allowed);
+  if (sent > 0) {
+    tx.erase(0, (size_t)sent);
+    txBudget -= sent;
+  }
+}
+
+// Parses up to 10 bytes of hex, zero-padding a short trailing digit.
+size_t parseSerial(const char *hex, uint8_t *out) {
+  size_t n = 0;
+  for (; hex[0] && n < 10; hex += hex[1] ? 2 : 1) {
+    char pair[3] = {hex[0], hex[1] ? hex[1] : '0', 0};
+    out[n++] = (uint8_t)strtoul(pair, nullptr, 16);
+  }
+  return n;
+}
+
+bool takeOption(int argc, char **argv, int &i, const char *name, const char *&value) {
+  if (strcmp(argv[i], name) != 0 || i + 1 >= argc) return false;
+  value = argv[++i];
+  return true;
+}
+}
+
+int main(int argc, char **argv) {
+  const char *link = nullptr, *image = nullptr, *value = nullptr;
+  unsigned long baud = 115200, writeUs = 0;
+  long rxBuffer = -1, txBuffer = -1;
+  for (int i = 1; i < argc; i++) {
+    if (takeOption(argc, argv, i, "--link", link) || takeOption(argc, argv, i, "--eeprom", image)) continue;
+    if (takeOption(argc, argv, i, "--baud", value)) baud = strtoul(value, nullptr, 10);
+    else if (takeOption(argc, argv, i, "--write-us", value)) writeUs = strtoul(value, nullptr, 10);
+    else if (takeOption(argc, argv, i, "--rx-buffer", value)) rxBuffer = strtol(value, nullptr, 10);
+    else if (takeOption(argc, argv, i, "--tx-buffer", value)) txBuffer = strtol(value, nullptr, 10);
+    else if (takeOption(argc, argv, i, "--id", value)) {
+      uint8_t serial[10];
+      native::setChipSerial(serial, parseSerial(value, serial));
+    } else {
+      fprintf(stderr,
+              "usage: %s [--link PATH] [--eeprom FILE] [--baud N] [--write-us N] [--rx-buffer N] "
+              "[--tx-buffer N] [--id HEX]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  if (image && !native::eepromAttachFile(image)) {
+    perror(image);
+    return 1;
+  }
+  native::setEepromWriteLatency(writeUs);
+  // Without wire pacing a whole window lands at once, so 64-byte rings would
+  // only measure the host scheduler.
+  if (rxBuffer < 0) rxBuffer = baud ? 64 : 0;
+  if (txBuffer < 0) txBuffer = baud ? 64 : 0;
+  native::setSerialRxCapacity((size_t)rxBuffer);
+  native::setSerialTxCapacity((size_t)txBuffer);
+
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char *slave = ptsname(master);
+  // Holding the slave open keeps the master readable between clients; raw mode
+  // stops the line discipline from echoing or rewriting bytes before one attaches.
+  int hold = open(slave, O_RDWR | O_NOCTTY);
+  struct termios tio;
+  if (hold < 0 || tcgetattr(hold, &tio) < 0) {
+    perror(slave);
+    return 1;
+  }
+  cfmakeraw(&tio);
+  tcsetattr(hold, TCSANOW, &tio);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  if (link) {
+    unlink(link);
+    if (symlink(slave, link) < 0) {
+      perror(link);
+      return 1;
+    }
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  fprintf(stderr, "escrow emulator on %s%s%s, %lu baud, EEPROM %s, %lu us/cell write\n", slave,
+          link ? " -> " : "", link ? link : "", baud, image ? image : "in memory", writeUs);
+
+  bytesPerMicro = baud / 10.0 / 1e6;
+  rxTick = txTick = micros();
+  native::setSerialRxSource(deliverRx);
+  native::setSerialTxSink(deliverTx);
+  setup();
+  while (!stopRequested) {
+    deliverRx();
+    loop();
+    deliverTx();
+
+    bool txIdle = tx.empty() && !native::serialOutputPending();
+    if (txIdle && !native::serialPending() && rxIdle && !rxBudget) {
+      struct pollfd pfd = {master, POLLIN, 0};
+      poll(&pfd, 1, 1);
+    }
+  }
+
+  if (link) unlink(link);
+  close(hold);
+  close(master);
+  return 0;
+}
+
+#endif
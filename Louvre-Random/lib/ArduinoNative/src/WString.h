@@ -0,0 +1,78 @@
+#pragma once
+/*
+  Host stand-in for the Arduino String class.
+  Only the members the firmware actually uses are provided; semantics follow
+  the AVR core (indexOf returns -1, substring clamps, trim strips whitespace).
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+public:
+  String() {}
+  String(const char *s) : buf_(s ? s : "") {}
+  String(const char *s, size_t len) : buf_(s, len) {}
+  String(const __FlashStringHelper *s) : buf_(reinterpret_cast<const char *>(s)) {}
+  String(char c) : buf_(1, c) {}
+  String(int v) : buf_(std::to_string(v)) {}
+  String(unsigned int v) : buf_(std::to_string(v)) {}
+  String(long v) : buf_(std::to_string(v)) {}
+  String(unsigned long v) : buf_(std::to_string(v)) {}
+
+  unsigned int length() const { return (unsigned int)buf_.size(); }
+  const char *c_str() const { return buf_.c_str(); }
+
+  char operator[](unsigned int i) const { return i < buf_.size() ? buf_[i] : '\0'; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  bool operator==(const String &rhs) const { return buf_ == rhs.buf_; }
+  bool operator==(const char *rhs) const { return buf_ == (rhs ? rhs : ""); }
+  bool operator!=(const String &rhs) const { return !(*this == rhs); }
+  bool operator!=(const char *rhs) const { return !(*this == rhs); }
+  bool equals(const String &rhs) const { return *this == rhs; }
+
+  String &operator+=(const String &rhs) { buf_ += rhs.buf_; return *this; }
+  String &operator+=(const char *rhs) { buf_ += rhs ? rhs : ""; return *this; }
+  String &operator+=(char c) { buf_ += c; return *this; }
+  bool concat(char c) { buf_ += c; return true; }
+
+  bool startsWith(const String &prefix) const { return buf_.compare(0, prefix.buf_.size(), prefix.buf_) == 0; }
+  bool endsWith(const String &suffix) const {
+    return buf_.size() >= suffix.buf_.size() &&
+           buf_.compare(buf_.size() - suffix.buf_.size(), suffix.buf_.size(), suffix.buf_) == 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t pos = buf_.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= buf_.size()) return String();
+    if (to > buf_.size()) to = (unsigned int)buf_.size();
+    return String(buf_.c_str() + from, to - from);
+  }
+
+  void trim() {
+    const char *ws = " \t\r\n\f\v";
+    size_t first = buf_.find_first_not_of(ws);
+    if (first == std::string::npos) { buf_.clear(); return; }
+    size_t last = buf_.find_last_not_of(ws);
+    buf_ = buf_.substr(first, last - first + 1);
+  }
+
+  void toUpperCase() { for (char &c : buf_) if (c >= 'a' && c <= 'z') c -= 32; }
+  long toInt() const { return strtol(buf_.c_str(), nullptr, 10); }
+
+private:
+  std::string buf_;
+};
+
+inline String operator+(String lhs, const String &rhs) { lhs += rhs; return lhs; }
+inline String operator+(String lhs, const char *rhs) { lhs += rhs; return lhs; }
@@ -2,35 +2,347 @@
 #include <Arduino.h>
 #include <ctype.h>
 #include <string.h>
+#ifdef __AVR__
+#include <avr/boot.h>
+#endif
 
 #ifdef HEX
 #undef HEX
 #endif
 
+#ifndef STATUS_LED
 #define STATUS_LED 13
+#endif
+#ifndef RELEASE_PIN
 #define RELEASE_PIN 9
-#define MAX_AUCTIONS 5
+#endif
+#define PULSE_MS 500
 #define AUCTION_ID_LEN 12
 #define TOKEN_LEN 32 // 32 bytes (64 hex chars)
 
+// Bytes of storage the record log may use. AVR cores describe their EEPROM
+// with E2END; boards with flash-emulated EEPROM (ESP32) set STORE_BYTES in
+// platformio.ini.
+#ifndef STORE_BYTES
+#define STORE_BYTES (E2END + 1)
+#endif
+
+// ----------------------------------------------------
+// Record log layout
+// ----------------------------------------------------
+// EEPROM is used as a ring of LOG_PAGES pages. Each page starts with a
+// header {seq:2, magic:1} followed by records appended back to back:
+//   [type][idLen][id bytes][token (key records only)][crc16]
+// The newest record per auction/field wins and a tombstone drops the auction.
+// A reservation record (id only) holds a slot for an auction that has no keys
+// yet and dies once the first key record for it lands.
+// When no free page is left, the oldest page's live records are re-appended
+// at the head and the page is recycled, so writes rotate over the whole EEPROM.
+#define LOG_PAGE_SIZE 128
+#define PAGE_HEADER_SIZE 3
+#define PAGE_MAGIC 0xA5
+
+#define REC_ITEM_KEY 0x11
+#define REC_PURCHASE_KEY 0x12
+#define REC_TOMBSTONE 0x13
+#define REC_RESERVE 0x14
+#define REC_END 0xFF                // erased byte terminates a page
+
+#define LINE_BUFFER_SIZE 96         // longest valid line is #255:ITEM:<12>:<64 hex>
+#define LINE_OVERFLOW 0xFF          // length marker for a line that outgrew LINE_BUFFER_SIZE
+
+// Flow control: received lines wait in the inbox, packed back to back behind
+// a length byte, so short lines leave room for more. A host
+// that tags commands "#<seq>:" (binary: OP_SEQ + seq byte) is sent
+//   ACK:<last seq>:<count>:<limit>
+// once the inbox drains or ACK_BATCH tagged commands have completed, instead
+// of one OK_* line each; errors and data-bearing replies still come back
+// individually, tagged with their seq. <count> lets the host spot a lost
+// line, and it may keep sending while its line count (mod 256, since boot or
+// the last SYNC) is below <limit>. The limit only counts lines that fit at
+// full length, and SYNC_ROOM bytes are held back for SYNC, which replies
+// SYNC:<last seq>:<count>:<limit> and restarts the line count.
+// Two full-length lines is the whole credit window for key-bearing commands;
+// a deeper inbox would eat the stack headroom an Uno's 2 KB of SRAM leaves.
+#define INBOX_LINES 2               // full-length lines the inbox holds
+#define SYNC_ROOM 8                 // length byte + "SYNC" or a 5-byte SYNC frame
+#define INBOX_BYTES (INBOX_LINES * (LINE_BUFFER_SIZE + 1) + SYNC_ROOM)
+#define ACK_BATCH 2
+
+// Binary mode (entered with the BINARY text command): each frame is
+// COBS-encoded and 0x00-terminated; decoded it reads
+//   [len][op][payload (len - 1 bytes)][crc16 over len..payload]
+// Requests carry [idLen][id][raw 32-byte token(s)]; replies use op | OP_REPLY
+// with a status byte first, then [idLen][id] and any released keys. ACK/SYNC
+// replies carry [last seq][count][limit]. STATS replies carry the text report
+// split over OK frames, then a DONE frame. RESERVE takes [idLen][id]; the INFO
+// reply carries [idLen][device id][slots:2][used:2][log free:2][CAP_* bits].
+#define OP_ADD 0x01
+#define OP_ITEM 0x02
+#define OP_BUY 0x03
+#define OP_ERASE 0x04
+#define OP_LIST 0x05
+#define OP_RESET 0x06
+#define OP_KEYS 0x07                // item + purchase key in one frame
+#define OP_SYNC 0x08
+#define OP_ACK 0x09                 // unsolicited batched ack (reply only)
+#define OP_STATS 0x0A               // payload [1] also resets the counters
+#define OP_INFO 0x0B
+#define OP_RESERVE 0x0C
+#define OP_TEXT 0x0F                // leave binary mode
+#define OP_SEQ 0x40                 // a seq byte follows the op
+#define OP_REPLY 0x80
+
+#define ST_OK 0x00
+#define ST_ERR_FORMAT 0x01
+#define ST_ERR_FULL 0x02
+#define ST_ERR_NO_ITEM 0x03
+#define ST_ERR_NO_PURCHASE_KEY 0x04
+#define ST_ERR_MISMATCH 0x05
+#define ST_ERR_NOT_FOUND 0x06
+#define ST_ERR_SYNTAX 0x07
+#define ST_ERR_UNKNOWN_CMD 0x08
+#define ST_ERR_CORRUPT 0x09
+#define ST_DONE 0x0A                // end of a multi-frame LIST or STATS reply
+
+// Capabilities advertised by INFO, so a host can tell firmware generations apart.
+#define CAP_SEQ 0x01                // #<seq> tags, batched ACKs and SYNC
+#define CAP_BINARY 0x02
+#define CAP_STATS 0x04
+#define CAP_RESERVE 0x08
+#define FIRMWARE_CAPS (CAP_SEQ | CAP_BINARY | CAP_STATS | CAP_RESERVE)
+#define DEVICE_ID_LEN 20            // hex chars; the AVR serial number is 10 bytes
+
+#define MAX_REPLY_SIZE (6 + 1 + AUCTION_ID_LEN + 2 * TOKEN_LEN)
+#define MAX_FRAME_SIZE (MAX_REPLY_SIZE + MAX_REPLY_SIZE / 254 + 2)
+
+// Log geometry for a store of Bytes bytes cut into PageSize pages, holding
+// records for IDs of up to IdLen bytes and TokenLen-byte keys. The slot count
+// is the most complete auctions the log is sure to hold at once: each needs an
+// item and a purchase key record at the longest ID, records never straddle
+// pages, and one page is always held back for compaction. One more record's
+// worth stays spare so a key can be replaced while the record it supersedes is
+// still live. Short IDs pack more records per page, but slots are capped at the
+// longest-ID count on purpose: a bigger index would cost an Uno SRAM and could
+// promise room a later long ID doesn't get. INFO's log_free tracks real usage.
+template <uint16_t Bytes, uint16_t PageSize, uint8_t IdLen, uint8_t TokenLen>
+struct LogLayout {
+  static constexpr uint8_t recordOverhead = 4;     // type + idLen + crc16
+  static constexpr uint8_t maxRecordSize = recordOverhead + IdLen + TokenLen;
+  static constexpr uint8_t pages = Bytes / PageSize;
+  static constexpr uint8_t recordsPerPage = (PageSize - PAGE_HEADER_SIZE) / maxRecordSize;
+  static constexpr uint16_t keyRecords = (pages - 1) * recordsPerPage - 1;
+  static constexpr uint16_t slots = keyRecords / 2;
+
+  static_assert(Bytes % PageSize == 0, "storage must be a whole number of log pages");
+  static_assert(Bytes / PageSize >= 3 && Bytes / PageSize <= 255, "page numbers are 8-bit and compaction needs spare pages");
+  static_assert(PageSize - PAGE_HEADER_SIZE >= maxRecordSize, "a page must hold the largest record");
+  static_assert(slots >= 1, "storage must hold at least one complete auction");
+};
+
+typedef LogLayout<STORE_BYTES, LOG_PAGE_SIZE, AUCTION_ID_LEN, TOKEN_LEN> StoreLayout;
+constexpr uint8_t REC_OVERHEAD = StoreLayout::recordOverhead;
+constexpr uint8_t MAX_RECORD_SIZE = StoreLayout::maxRecordSize;
+constexpr uint8_t LOG_PAGES = StoreLayout::pages;
+constexpr uint16_t MAX_AUCTIONS = StoreLayout::slots;   // RAM index sized to what the log can hold
+
+// RAM view of one auction, assembled from its records by readEntry().
 struct Entry {
-  uint8_t used;                 // 0 = free, 1 = used
   char auctionId[AUCTION_ID_LEN + 1];
   uint8_t itemKey[TOKEN_LEN];
   uint8_t purchaseKey[TOKEN_LEN];
   bool hasItemKey;
   bool hasPurchaseKey;
-  uint16_t crc;
 };
 
-const uint16_t ENTRY_SIZE = sizeof(Entry);
+// Borrowed, non-terminated slice of an inbox line handed to the command handlers.
+struct Span {
+  const char *ptr;
+  uint8_t len;
+};
 
 Entry entryBuffer;
+int bufferedSlot = -1;          // slot currently mirrored in entryBuffer, -1 if none
+
+// RAM index, rebuilt from the log in setup(). A slot is free when it points at
+// no records; addresses are never 0 because offset 0 holds page 0's header.
+struct SlotIndex {
+  uint16_t hash;
+  uint16_t itemAddr;
+  uint16_t purchaseAddr;
+  uint16_t reserveAddr;         // reservation record, 0 once a key is stored
+};
+
+SlotIndex slotIndex[MAX_AUCTIONS];
+#ifdef RAMEND
+static_assert(sizeof(slotIndex) <= (RAMEND - RAMSTART + 1) / 8, "slot index would crowd out the stack");
+#endif
+
+uint8_t headPage;               // page currently being appended to
+uint8_t tailPage;               // oldest page still holding records
+uint16_t headOffset;            // next free byte inside headPage
+uint16_t headSeq;               // sequence number of headPage
+bool logFull;                   // last compaction round failed; cleared once records die
+uint8_t recordBuffer[MAX_RECORD_SIZE];
+
+// [length][bytes] per complete line, oldest first, then the line being received
+char inbox[INBOX_BYTES];
+uint8_t inboxUsed;              // bytes held by complete lines
+uint8_t inboxCount;             // complete lines waiting for dispatch
+uint8_t lineLength;             // bytes of the line being received
+bool lineOverflow;              // line outgrew LINE_BUFFER_SIZE; rejected at its end
+uint8_t rxLines;                // lines received since boot or the last SYNC (mod 256)
+bool binaryMode;
+
+int16_t replySeq = -1;          // seq of the command being dispatched, -1 if untagged
+uint8_t ackSeq;                 // newest tagged command completed
+uint8_t ackCount;               // tagged commands completed since the last ACK
+bool syncRequested;
+
+uint8_t replyBuffer[MAX_REPLY_SIZE];
+uint8_t frameBuffer[MAX_FRAME_SIZE];
+
+// Pending EEPROM writes, committed in order by the EEPROM-ready interrupt so a
+// ~3.3 ms cell write never stalls loop(). Reads consult the queue first.
+#define WRITE_QUEUE_SIZE 64             // power of two
+#define WRITE_QUEUE_MASK (WRITE_QUEUE_SIZE - 1)
+
+struct PendingWrite {
+  uint16_t addr;
+  uint8_t value;
+};
+
+PendingWrite writeQueue[WRITE_QUEUE_SIZE];
+volatile uint8_t writeHead;     // next free entry, advanced by storeWrite()
+volatile uint8_t writeTail;     // oldest entry, advanced once its write completes
+volatile bool writeInFlight;
+
+// Millis-driven one-shot tasks (pin pulses) run from loop().
+#define MAX_TASKS 4
+
+struct Task {
+  unsigned long due;
+  void (*fn)(uint8_t);
+  uint8_t arg;
+};
+
+Task tasks[MAX_TASKS];
+
+// Telemetry reported by STATS. Each dispatched command's time is split into
+// exclusive phases (a CRC inside a persist counts only as CRC); whatever no
+// phase claims, mostly serial output, is charged to PHASE_REPLY. Histogram
+// bucket b counts commands whose phase took under 16 << 2b us (16 us .. 65 ms,
+// wide enough for EEPROM-bound persists); the last bucket is open ended. STATS
+// itself is left out so scraping doesn't skew the numbers.
+#define PHASE_PARSE 0
+#define PHASE_LOOKUP 1
+#define PHASE_CRC 2
+#define PHASE_PERSIST 3
+#define PHASE_REPLY 4
+#define PHASE_TOTAL 5                   // whole dispatch, not a phase of its own
+#define PHASE_COUNT 6
+#define HIST_BUCKETS 8
+
+struct PhaseStats {
+  uint32_t count;
+  uint32_t totalMicros;
+  uint32_t maxMicros;
+  uint16_t histogram[HIST_BUCKETS];     // saturate at 65535
+};
+
+PhaseStats phaseStats[PHASE_COUNT];
+uint32_t phaseMicros[PHASE_TOTAL];      // time spent by the command being dispatched
+uint8_t phasesUsed;                     // bit per phase the command entered
+uint8_t activePhase = PHASE_REPLY;
+unsigned long phaseMark;                // micros() at the last phase switch
+uint8_t dispatchedOp;                   // OP_* of the command being dispatched, 0 if unknown
+uint16_t commandCounts[16];             // by OP_*; 0 counts unknown and malformed commands
+uint16_t errorCount;
+uint32_t pageWrites[LOG_PAGES];         // EEPROM cells written per log page (wear)
+uint8_t rxPeak;                         // most bytes seen waiting in the serial RX ring
+uint8_t inboxPeak;
+uint8_t queuePeak;                      // deepest EEPROM write queue
+uint16_t sramLow = 0xFFFF;              // least free SRAM seen at a phase switch
+
+// ----------------------------------------------------
+// Telemetry
+// ----------------------------------------------------
+// Bytes between the heap and the stack; the host build has no such gap and reports 0.
+uint16_t freeSram() {
+#ifdef __AVR__
+  extern char __heap_start, *__brkval;
+  char top;
+  return &top - (__brkval ? __brkval : &__heap_start);
+#else
+  return 0;
+#endif
+}
+
+// Charges the time since the last switch to the active phase and makes phase
+// active; returns the phase it interrupted.
+uint8_t enterPhase(uint8_t phase) {
+  unsigned long now = micros();
+  phaseMicros[activePhase] += now - phaseMark;
+  phaseMark = now;
+  uint8_t outer = activePhase;
+  activePhase = phase;
+  phasesUsed |= 1 << phase;
+  uint16_t spare = freeSram();
+  if (spare < sramLow) sramLow = spare;
+  return outer;
+}
+
+// Times the enclosing scope as one phase, resuming the interrupted one on exit.
+struct PhaseScope {
+  uint8_t outer;
+  explicit PhaseScope(uint8_t phase) : outer(enterPhase(phase)) {}
+  ~PhaseScope() { enterPhase(outer); }
+};
+
+void recordPhase(uint8_t phase, uint32_t us) {
+  PhaseStats &s = phaseStats[phase];
+  s.count++;
+  s.totalMicros += us;
+  if (us > s.maxMicros) s.maxMicros = us;
+  uint8_t b = 0;
+  while (b < HIST_BUCKETS - 1 && us >= (16UL << (2 * b))) b++;
+  if (s.histogram[b] != 0xFFFF) s.histogram[b]++;
+}
+
+void beginCommandStats() {
+  memset(phaseMicros, 0, sizeof(phaseMicros));
+  phasesUsed = 0;
+  dispatchedOp = 0;
+  activePhase = PHASE_REPLY;
+  phaseMark = micros();
+}
+
+void endCommandStats() {
+  enterPhase(PHASE_REPLY);
+  if (dispatchedOp == OP_STATS) return;
+  uint32_t total = 0;
+  for (uint8_t p = 0; p < PHASE_TOTAL; p++) {
+    total += phaseMicros[p];
+    if (phasesUsed & (1 << p)) recordPhase(p, phaseMicros[p]);
+  }
+  recordPhase(PHASE_TOTAL, total);
+  if (commandCounts[dispatchedOp] != 0xFFFF) commandCounts[dispatchedOp]++;
+}
+
+void resetStats() {
+  memset(phaseStats, 0, sizeof(phaseStats));
+  memset(commandCounts, 0, sizeof(commandCounts));
+  memset(pageWrites, 0, sizeof(pageWrites));
+  errorCount = 0;
+  rxPeak = inboxPeak = queuePeak = 0;
+  sramLow = 0xFFFF;
+}
 
 // ----------------------------------------------------
 // CRC helper
 // ----------------------------------------------------
 uint16_t computeCRC(const uint8_t *data, uint16_t len) {
+  PhaseScope phase(PHASE_CRC);
   uint16_t crc = 0xFFFF;
   for (int i = 0; i < len; i++) {
     crc ^= (uint16_t)data[i] << 8;
@@ -44,84 +356,674 @@ uint16_t computeCRC(const uint8_t *data, uint16_t len) {
   return crc;
 }
 
-uint16_t entryCrc(const Entry &entry) {
-  return computeCRC(reinterpret_cast<const uint8_t *>(&entry), sizeof(Entry) - sizeof(entry.crc));
+// ----------------------------------------------------
+// Serial inbox
+// ----------------------------------------------------
+// Moves received bytes into the inbox without blocking. Text mode ends lines
+// on '\n', binary mode ends COBS frames on 0x00; empty lines are dropped.
+// Reading stops while the inbox has no room for another byte, so queued lines
+// are never overwritten; an overlong line keeps only its length byte.
+void pumpSerial() {
+  char terminator = binaryMode ? 0 : '\n';
+  int pending = Serial.available();
+  if (pending > rxPeak) rxPeak = pending;
+  while (inboxUsed + 1 + lineLength < INBOX_BYTES && Serial.available()) {
+    char c = Serial.read();
+    if (c != terminator) {
+      if (lineLength < LINE_BUFFER_SIZE) inbox[inboxUsed + 1 + lineLength++] = c;
+      else lineOverflow = true;
+      continue;
+    }
+    if (!lineLength && !lineOverflow) continue;
+    inbox[inboxUsed] = lineOverflow ? LINE_OVERFLOW : lineLength;
+    inboxUsed += 1 + (lineOverflow ? 0 : lineLength);
+    inboxCount++;
+    if (inboxCount > inboxPeak) inboxPeak = inboxCount;
+    rxLines++;
+    lineLength = 0;
+    lineOverflow = false;
+  }
+}
+
+// Output for every reply. A reply longer than the TX ring would block in
+// Serial.write() until the UART catches up; waiting here instead keeps moving
+// received bytes into the inbox, so lines the credit window let the host send
+// meanwhile can't overrun the RX ring.
+struct PumpedSerial : public Print {
+  size_t write(uint8_t c) override {
+    while (Serial.availableForWrite() <= 0) pumpSerial();
+    return Serial.write(c);
+  }
+  using Print::write;
+};
+
+PumpedSerial serialOut;
+
+// Highest line count the host may reach before waiting for the next ACK. The
+// line being received counts against the room, so the estimate errs low.
+uint8_t creditLimit() {
+  uint8_t used = inboxUsed + (lineLength ? 1 + lineLength : 0);
+  uint8_t room = used < INBOX_BYTES - SYNC_ROOM ? INBOX_BYTES - SYNC_ROOM - used : 0;
+  return rxLines + room / (LINE_BUFFER_SIZE + 1);
+}
+
+// Drops the dispatched head line and slides the rest of the inbox down.
+void dropLine() {
+  uint8_t length = inbox[0];
+  uint8_t size = 1 + (length == LINE_OVERFLOW ? 0 : length);
+  memmove(inbox, inbox + size, inboxUsed + 1 + lineLength - size);
+  inboxUsed -= size;
+  inboxCount--;
 }
 
 // ----------------------------------------------------
-// EEPROM helpers
+// EEPROM write engine
 // ----------------------------------------------------
-int findFreeSlot() {
+#ifdef __AVR__
+ISR(EE_READY_vect) {
+  if (writeInFlight) {
+    writeTail++;
+    writeInFlight = false;
+  }
+  if (writeTail == writeHead) {
+    EECR &= ~_BV(EERIE);
+    return;
+  }
+  const PendingWrite &w = writeQueue[writeTail & WRITE_QUEUE_MASK];
+  EEAR = w.addr;
+  EEDR = w.value;
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+  writeInFlight = true;
+}
+
+// Masks the ready interrupt while waiting so a busy queue can't starve the read.
+uint8_t rawRead(uint16_t addr) {
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t rie = EECR & _BV(EERIE);
+  EECR &= ~_BV(EERIE);
+  SREG = sreg;
+  while (EECR & _BV(EEPE)) {}
+  cli();
+  EEAR = addr;
+  EECR |= _BV(EERE);
+  uint8_t value = EEDR;
+  EECR |= rie;
+  SREG = sreg;
+  return value;
+}
+#else
+// Other targets have no EEPROM interrupt; loop() commits the queue instead, one
+// cell each time eeprom_is_ready() (the emulator can give writes a latency).
+#ifdef ESP32
+// Flash-emulated EEPROM writes land in a RAM mirror and never stall; see
+// serviceWriteQueue() for when the mirror is flushed.
+bool eeprom_is_ready() { return true; }
+#endif
+
+void commitOldestWrite() {
+  const PendingWrite &w = writeQueue[writeTail & WRITE_QUEUE_MASK];
+  EEPROM.write(w.addr, w.value);
+  writeTail++;
+}
+
+uint8_t rawRead(uint16_t addr) {
+  while (!eeprom_is_ready()) {}
+  return EEPROM.read(addr);
+}
+#endif
+
+uint8_t queuedWrites() {
+  return (uint8_t)(writeHead - writeTail);
+}
+
+uint8_t storeRead(uint16_t addr) {
+  noInterrupts();
+  for (uint8_t i = writeHead; i != writeTail;) {
+    const PendingWrite &w = writeQueue[--i & WRITE_QUEUE_MASK];
+    if (w.addr == addr) {
+      uint8_t value = w.value;
+      interrupts();
+      return value;
+    }
+  }
+  interrupts();
+  return rawRead(addr);
+}
+
+void storeReadBytes(uint16_t addr, uint8_t *out, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) out[i] = storeRead(addr + i);
+}
+
+void serviceWriteQueue() {
+#ifndef __AVR__
+  if (!queuedWrites()) return;
+  while (queuedWrites() && eeprom_is_ready()) commitOldestWrite();
+#ifdef ESP32
+  // One commit per drained batch: it rewrites the whole flash-backed image.
+  if (!queuedWrites()) EEPROM.commit();
+#endif
+#endif
+}
+
+// Queues a cell write (skipped if unchanged); only blocks when the queue is full,
+// and keeps draining the serial RX ring into the inbox meanwhile.
+void storeWrite(uint16_t addr, uint8_t value) {
+  if (storeRead(addr) == value) return;
+  while (queuedWrites() >= WRITE_QUEUE_SIZE) {
+    pumpSerial();
+    serviceWriteQueue();
+  }
+  noInterrupts();
+  writeQueue[writeHead & WRITE_QUEUE_MASK] = {addr, value};
+  writeHead++;
+#ifdef __AVR__
+  EECR |= _BV(EERIE);
+#endif
+  interrupts();
+  if (queuedWrites() > queuePeak) queuePeak = queuedWrites();
+  pageWrites[addr / LOG_PAGE_SIZE]++;
+}
+
+// ----------------------------------------------------
+// Task scheduler
+// ----------------------------------------------------
+// Re-scheduling the same fn/arg replaces the pending task, so repeated pulses
+// on one pin extend it instead of stacking.
+bool scheduleTask(unsigned long delayMs, void (*fn)(uint8_t), uint8_t arg) {
+  int slot = -1;
+  for (int i = 0; i < MAX_TASKS; i++) {
+    if (tasks[i].fn == fn && tasks[i].arg == arg) {
+      slot = i;
+      break;
+    }
+    if (!tasks[i].fn && slot < 0) slot = i;
+  }
+  if (slot < 0) return false;
+  tasks[slot].due = millis() + delayMs;
+  tasks[slot].fn = fn;
+  tasks[slot].arg = arg;
+  return true;
+}
+
+void runTasks() {
+  unsigned long now = millis();
+  for (int i = 0; i < MAX_TASKS; i++) {
+    if (!tasks[i].fn || (long)(now - tasks[i].due) < 0) continue;
+    void (*fn)(uint8_t) = tasks[i].fn;
+    tasks[i].fn = nullptr;
+    fn(tasks[i].arg);
+  }
+}
+
+void cancelTasks() {
+  memset(tasks, 0, sizeof(tasks));
+}
+
+void pinLow(uint8_t pin) {
+  digitalWrite(pin, LOW);
+}
+
+void pulsePin(uint8_t pin, unsigned long ms) {
+  digitalWrite(pin, HIGH);
+  if (!scheduleTask(ms, pinLow, pin)) digitalWrite(pin, LOW);
+}
+
+// ----------------------------------------------------
+// Slot index
+// ----------------------------------------------------
+uint16_t idHash(const char *id, uint8_t len) {
+  uint16_t h = 5381;
+  for (uint8_t i = 0; i < len; i++) h = (h << 5) + h + (uint8_t)id[i];
+  return h;
+}
+
+bool isSlotUsed(int slot) {
+  return slotIndex[slot].itemAddr || slotIndex[slot].purchaseAddr || slotIndex[slot].reserveAddr;
+}
+
+uint16_t slotRecordAddr(int slot) {
+  if (slotIndex[slot].itemAddr) return slotIndex[slot].itemAddr;
+  return slotIndex[slot].purchaseAddr ? slotIndex[slot].purchaseAddr : slotIndex[slot].reserveAddr;
+}
+
+bool recordIdEquals(uint16_t addr, const char *id, uint8_t len) {
+  if (storeRead(addr + 1) != len) return false;
+  for (uint8_t i = 0; i < len; i++)
+    if (storeRead(addr + 2 + i) != (uint8_t)id[i]) return false;
+  return true;
+}
+
+int lookupSlot(const char *id, uint8_t len) {
+  uint16_t h = idHash(id, len);
   for (int i = 0; i < MAX_AUCTIONS; i++) {
-    int addr = i * ENTRY_SIZE;
-    if (EEPROM.read(addr) != 1) return i;
+    if (!isSlotUsed(i) || slotIndex[i].hash != h) continue;
+    if (recordIdEquals(slotRecordAddr(i), id, len)) return i;
   }
   return -1;
 }
 
-int findSlotByAuction(const String &id) {
+// ----------------------------------------------------
+// Record log
+// ----------------------------------------------------
+uint16_t pageBase(uint8_t page) {
+  return (uint16_t)page * LOG_PAGE_SIZE;
+}
+
+uint8_t nextPage(uint8_t page) {
+  return (page + 1) % LOG_PAGES;
+}
+
+uint8_t freePages() {
+  return LOG_PAGES - ((headPage + LOG_PAGES - tailPage) % LOG_PAGES + 1);
+}
+
+bool isKeyRecord(uint8_t type) {
+  return type == REC_ITEM_KEY || type == REC_PURCHASE_KEY;
+}
+
+uint8_t recordSize(uint8_t type, uint8_t idLen) {
+  return REC_OVERHEAD + idLen + (isKeyRecord(type) ? TOKEN_LEN : 0);
+}
+
+// Reads and validates the record at addr into recordBuffer; returns its size or 0.
+uint8_t loadRecord(uint16_t addr, uint16_t limit) {
+  uint8_t type = storeRead(addr);
+  if (!isKeyRecord(type) && type != REC_TOMBSTONE && type != REC_RESERVE) return 0;
+  if (addr + 2 > limit) return 0;
+  uint8_t idLen = storeRead(addr + 1);
+  if (idLen > AUCTION_ID_LEN) return 0;
+  uint8_t size = recordSize(type, idLen);
+  if (addr + size > limit) return 0;
+  storeReadBytes(addr, recordBuffer, size);
+  uint16_t crc = recordBuffer[size - 2] | ((uint16_t)recordBuffer[size - 1] << 8);
+  return computeCRC(recordBuffer, size - 2) == crc ? size : 0;
+}
+
+void openPage(uint8_t page, uint16_t seq) {
+  uint16_t base = pageBase(page);
+  storeWrite(base + 2, 0);              // queued writes commit in order, so
+  storeWrite(base, seq & 0xFF);         // the page only turns valid once its
+  storeWrite(base + 1, seq >> 8);       // seq and terminator are in place
+  storeWrite(base + PAGE_HEADER_SIZE, REC_END);
+  storeWrite(base + 2, PAGE_MAGIC);
+  headPage = page;
+  headSeq = seq;
+  headOffset = PAGE_HEADER_SIZE;
+}
+
+void releasePage(uint8_t page) {
+  storeWrite(pageBase(page) + 2, 0);
+}
+
+// Appends the record staged in recordBuffer; the caller guarantees it fits.
+// The type byte is the commit byte and goes last: until it lands, addr still
+// holds REC_END, so a power cut can't expose a half-written record, or a stale
+// one left on a recycled page whose body and CRC happen to be intact.
+uint16_t appendRecord(uint8_t size) {
+  if (headOffset + size > LOG_PAGE_SIZE) openPage(nextPage(headPage), headSeq + 1);
+  uint16_t addr = pageBase(headPage) + headOffset;
+  if (headOffset + size < LOG_PAGE_SIZE) storeWrite(addr + size, REC_END);
+  for (uint8_t i = 1; i < size; i++) storeWrite(addr + i, recordBuffer[i]);
+  storeWrite(addr, recordBuffer[0]);
+  headOffset += size;
+  return addr;
+}
+
+uint8_t stageRecord(uint8_t type, const char *id, uint8_t idLen, const uint8_t *token) {
+  uint8_t size = recordSize(type, idLen);
+  recordBuffer[0] = type;
+  recordBuffer[1] = idLen;
+  memcpy(recordBuffer + 2, id, idLen);
+  if (isKeyRecord(type)) memcpy(recordBuffer + 2 + idLen, token, TOKEN_LEN);
+  uint16_t crc = computeCRC(recordBuffer, size - 2);
+  recordBuffer[size - 2] = crc & 0xFF;
+  recordBuffer[size - 1] = crc >> 8;
+  return size;
+}
+
+// Applies the record replayed from addr (staged in recordBuffer) to the RAM index.
+void indexRecord(uint16_t addr) {
+  uint8_t type = recordBuffer[0];
+  const char *id = reinterpret_cast<const char *>(recordBuffer + 2);
+  uint8_t idLen = recordBuffer[1];
+  int slot = -1;
+  uint16_t h = idHash(id, idLen);
+  for (int i = 0; i < MAX_AUCTIONS && slot < 0; i++) {
+    if (isSlotUsed(i) && slotIndex[i].hash == h && recordIdEquals(slotRecordAddr(i), id, idLen)) slot = i;
+  }
+
+  if (type == REC_TOMBSTONE) {
+    if (slot >= 0) slotIndex[slot].itemAddr = slotIndex[slot].purchaseAddr = slotIndex[slot].reserveAddr = 0;
+    return;
+  }
+  if (slot < 0) {
+    for (int i = 0; i < MAX_AUCTIONS && slot < 0; i++)
+      if (!isSlotUsed(i)) slot = i;
+    if (slot < 0) return;
+    slotIndex[slot].hash = h;
+  }
+  if (type == REC_RESERVE) {
+    if (!slotIndex[slot].itemAddr && !slotIndex[slot].purchaseAddr) slotIndex[slot].reserveAddr = addr;
+    return;
+  }
+  if (type == REC_ITEM_KEY) slotIndex[slot].itemAddr = addr;
+  else slotIndex[slot].purchaseAddr = addr;
+  slotIndex[slot].reserveAddr = 0;
+}
+
+// Moves the live records out of the oldest page and recycles it.
+bool compactTail() {
+  if (tailPage == headPage) return false;
+  uint16_t base = pageBase(tailPage);
+  uint16_t limit = base + LOG_PAGE_SIZE;
+  uint16_t addr = base + PAGE_HEADER_SIZE;
+  while (addr < limit) {
+    uint8_t size = loadRecord(addr, limit);
+    if (!size) break;
+    bool live = false;
+    for (int i = 0; i < MAX_AUCTIONS && !live; i++)
+      live = slotIndex[i].itemAddr == addr || slotIndex[i].purchaseAddr == addr || slotIndex[i].reserveAddr == addr;
+    if (live) {
+      uint16_t moved = appendRecord(size);
+      for (int i = 0; i < MAX_AUCTIONS; i++) {
+        if (slotIndex[i].itemAddr == addr) slotIndex[i].itemAddr = moved;
+        if (slotIndex[i].purchaseAddr == addr) slotIndex[i].purchaseAddr = moved;
+        if (slotIndex[i].reserveAddr == addr) slotIndex[i].reserveAddr = moved;
+      }
+    }
+    addr += size;
+  }
+  releasePage(tailPage);
+  tailPage = nextPage(tailPage);
+  return true;
+}
+
+// Bytes the active pages have consumed, counting closed pages as full.
+uint16_t logBytes() {
+  uint8_t active = LOG_PAGES - freePages();
+  return (uint16_t)(active - 1) * (LOG_PAGE_SIZE - PAGE_HEADER_SIZE) + headOffset - PAGE_HEADER_SIZE;
+}
+
+uint16_t liveBytes() {
+  uint16_t total = 0;
   for (int i = 0; i < MAX_AUCTIONS; i++) {
-    int addr = i * ENTRY_SIZE;
-    EEPROM.get(addr, entryBuffer);
-    uint16_t crcCheck = entryCrc(entryBuffer);
-    if (entryBuffer.used == 1 && crcCheck == entryBuffer.crc && String(entryBuffer.auctionId) == id) return i;
+    if (!isSlotUsed(i)) continue;
+    uint8_t idLen = storeRead(slotRecordAddr(i) + 1);
+    if (slotIndex[i].itemAddr) total += recordSize(REC_ITEM_KEY, idLen);
+    if (slotIndex[i].purchaseAddr) total += recordSize(REC_PURCHASE_KEY, idLen);
+    if (slotIndex[i].reserveAddr) total += recordSize(REC_RESERVE, idLen);
+  }
+  return total;
+}
+
+// Bytes the used slots have claimed: both key records at each slot's ID
+// length, whether the keys have arrived or only a reservation has.
+uint16_t committedBytes() {
+  uint16_t total = 0;
+  for (int i = 0; i < MAX_AUCTIONS; i++)
+    if (isSlotUsed(i)) total += 2 * recordSize(REC_ITEM_KEY, storeRead(slotRecordAddr(i) + 1));
+  return total;
+}
+
+// Room left for key records, counting only the whole ones each page takes.
+uint16_t logFreeBytes() {
+  uint16_t capacity = StoreLayout::keyRecords * MAX_RECORD_SIZE;
+  uint16_t committed = committedBytes();
+  return committed < capacity ? capacity - committed : 0;
+}
+
+uint16_t usedSlots() {
+  uint16_t used = 0;
+  for (int i = 0; i < MAX_AUCTIONS; i++)
+    if (isSlotUsed(i)) used++;
+  return used;
+}
+
+// Complete auctions (both keys at the longest ID) the log can still take.
+uint16_t freeAuctions() {
+  uint16_t fit = logFreeBytes() / (2 * MAX_RECORD_SIZE);
+  uint16_t unused = MAX_AUCTIONS - usedSlots();
+  return fit < unused ? fit : unused;
+}
+
+// Makes room for a record of the given size, recycling old pages as needed.
+// One page is always held back so compaction has somewhere to copy into, and
+// nothing is recycled unless the log holds enough dead bytes to pay for it.
+// A failed round is remembered so a full store doesn't churn on every retry.
+bool ensureSpace(uint8_t size) {
+  uint8_t attempts = 0;
+  while (headOffset + size > LOG_PAGE_SIZE) {
+    if (freePages() > 1) {
+      openPage(nextPage(headPage), headSeq + 1);
+      continue;
+    }
+    if (logFull || logBytes() < liveBytes() + size) return false;
+    if (++attempts > LOG_PAGES || !compactTail()) {
+      logFull = true;
+      return false;
+    }
   }
+  return true;
+}
+
+bool pageValid(uint8_t page, uint16_t &seq) {
+  if (storeRead(pageBase(page) + 2) != PAGE_MAGIC) return false;
+  seq = storeRead(pageBase(page)) | ((uint16_t)storeRead(pageBase(page) + 1) << 8);
+  return true;
+}
+
+// Finds the newest page, walks back to the oldest one in its chain and
+// replays every record in order to rebuild the RAM index.
+void mountStore() {
+  memset(slotIndex, 0, sizeof(slotIndex));
+  bufferedSlot = -1;
+  logFull = false;
+
+  int head = -1;
+  uint16_t seq = 0;
+  for (uint8_t p = 0; p < LOG_PAGES; p++) {
+    uint16_t s;
+    if (pageValid(p, s) && (head < 0 || (int16_t)(s - seq) > 0)) {
+      head = p;
+      seq = s;
+    }
+  }
+  if (head < 0) {
+    tailPage = 0;
+    openPage(0, 1);
+    return;
+  }
+
+  headPage = head;
+  headSeq = seq;
+  tailPage = head;
+  for (uint8_t n = 1; n < LOG_PAGES; n++) {
+    uint8_t prev = (tailPage + LOG_PAGES - 1) % LOG_PAGES;
+    uint16_t s;
+    if (!pageValid(prev, s) || s != (uint16_t)(seq - n)) break;
+    tailPage = prev;
+  }
+
+  for (uint8_t page = tailPage;; page = nextPage(page)) {
+    uint16_t base = pageBase(page);
+    uint16_t limit = base + LOG_PAGE_SIZE;
+    uint16_t addr = base + PAGE_HEADER_SIZE;
+    uint8_t size;
+    while (addr < limit && (size = loadRecord(addr, limit))) {
+      indexRecord(addr);
+      addr += size;
+    }
+    if (page == headPage) {
+      headOffset = addr - base;
+      break;
+    }
+  }
+}
+
+void wipeStore() {
+  PhaseScope phase(PHASE_PERSIST);
+  for (uint8_t p = 0; p < LOG_PAGES; p++) {
+    uint16_t s;
+    if (pageValid(p, s)) releasePage(p);
+  }
+  memset(slotIndex, 0, sizeof(slotIndex));
+  bufferedSlot = -1;
+  logFull = false;
+  tailPage = nextPage(headPage);
+  openPage(tailPage, headSeq + 1);
+}
+
+// ----------------------------------------------------
+// EEPROM helpers
+// ----------------------------------------------------
+// Hands out a slot only while the log can still hold both keys for it.
+int findFreeSlot() {
+  if (!freeAuctions()) return -1;
+  for (int i = 0; i < MAX_AUCTIONS; i++)
+    if (!isSlotUsed(i)) return i;
   return -1;
 }
 
-void eraseSlot(int i) {
-  int addr = i * ENTRY_SIZE;
-  for (int j = 0; j < ENTRY_SIZE; j++) EEPROM.write(addr + j, 0);
+// IDs are stored whole, so every command rejects one it couldn't store.
+bool validAuctionId(Span id) {
+  return id.len && id.len <= AUCTION_ID_LEN;
+}
+
+int findSlotByAuction(Span id) {
+  PhaseScope phase(PHASE_LOOKUP);
+  return lookupSlot(id.ptr, id.len);
+}
+
+// Drops the slot behind a tombstone; returns false, leaving the auction in
+// place, when the log has no room for the tombstone. Room is made while the
+// slot is still live so compaction carries its records along, never half of them.
+bool eraseSlot(int i) {
+  PhaseScope phase(PHASE_PERSIST);
+  if (!isSlotUsed(i)) return true;
+  uint16_t addr = slotRecordAddr(i);
+  char id[AUCTION_ID_LEN];
+  uint8_t idLen = storeRead(addr + 1);
+  storeReadBytes(addr + 2, reinterpret_cast<uint8_t *>(id), idLen);
+
+  uint8_t size = recordSize(REC_TOMBSTONE, idLen);
+  logFull = false;
+  if (!ensureSpace(size)) return false;
+  slotIndex[i].itemAddr = slotIndex[i].purchaseAddr = slotIndex[i].reserveAddr = 0;
+  if (bufferedSlot == i) bufferedSlot = -1;
+  stageRecord(REC_TOMBSTONE, id, idLen, nullptr);
+  appendRecord(size);
+  return true;
 }
 
 void clearAllSlots() {
-  for (int i = 0; i < MAX_AUCTIONS; i++) eraseSlot(i);
+  wipeStore();
 }
 
-void persistEntry(int slot, Entry &entry) {
-  entry.crc = entryCrc(entry);
-  int addr = slot * ENTRY_SIZE;
-  EEPROM.put(addr, entry);
+// Appends one key record for the slot; returns false when the log is full.
+// A slot already in use has both its key records committed, so its writes
+// always get a fresh compaction round instead of failing on logFull.
+bool persistKey(int slot, Span auctionId, uint8_t type, const uint8_t *token) {
+  PhaseScope phase(PHASE_PERSIST);
+  uint8_t idLen = auctionId.len;
+  uint8_t size = recordSize(type, idLen);
+  if (isSlotUsed(slot)) logFull = false;
+  if (!ensureSpace(size)) return false;
+  stageRecord(type, auctionId.ptr, idLen, token);
+  uint16_t addr = appendRecord(size);
+  slotIndex[slot].hash = idHash(auctionId.ptr, idLen);
+  if (type == REC_ITEM_KEY) slotIndex[slot].itemAddr = addr;
+  else slotIndex[slot].purchaseAddr = addr;
+  slotIndex[slot].reserveAddr = 0;
+  return true;
+}
+
+// Claims a slot for an auction whose keys are still to come.
+bool persistReservation(int slot, Span auctionId) {
+  PhaseScope phase(PHASE_PERSIST);
+  uint8_t idLen = auctionId.len;
+  uint8_t size = recordSize(REC_RESERVE, idLen);
+  if (!ensureSpace(size)) return false;
+  stageRecord(REC_RESERVE, auctionId.ptr, idLen, nullptr);
+  slotIndex[slot].hash = idHash(auctionId.ptr, idLen);
+  slotIndex[slot].reserveAddr = appendRecord(size);
+  return true;
 }
 
 // ----------------------------------------------------
 // Entry I/O
 // ----------------------------------------------------
-void writePurchaseKey(int slot, const String &auctionId, const uint8_t *token) {
-  Entry entry;
-  bool existing = readEntry(slot);
-  if (existing) {
-    entry = entryBuffer;
-  } else {
-    memset(&entry, 0, sizeof(entry));
-    entry.used = 1;
-    strncpy(entry.auctionId, auctionId.c_str(), AUCTION_ID_LEN);
-    entry.auctionId[AUCTION_ID_LEN] = '\0';
+bool readEntry(int slot) {
+  PhaseScope phase(PHASE_LOOKUP);
+  if (!isSlotUsed(slot)) return false;
+  if (bufferedSlot == slot) return true;
+
+  memset(&entryBuffer, 0, sizeof(entryBuffer));
+  uint16_t addr = slotRecordAddr(slot);
+  uint8_t idLen = storeRead(addr + 1);
+  storeReadBytes(addr + 2, reinterpret_cast<uint8_t *>(entryBuffer.auctionId), idLen);
+
+  uint16_t tokenOffset = 2 + idLen;
+  if (slotIndex[slot].itemAddr) {
+    storeReadBytes(slotIndex[slot].itemAddr + tokenOffset, entryBuffer.itemKey, TOKEN_LEN);
+    entryBuffer.hasItemKey = true;
+  }
+  if (slotIndex[slot].purchaseAddr) {
+    storeReadBytes(slotIndex[slot].purchaseAddr + tokenOffset, entryBuffer.purchaseKey, TOKEN_LEN);
+    entryBuffer.hasPurchaseKey = true;
   }
+  bufferedSlot = slot;
+  return true;
+}
 
-  for (int i = 0; i < TOKEN_LEN; i++) entry.purchaseKey[i] = token[i];
-  entry.hasPurchaseKey = true;
-  persistEntry(slot, entry);
+bool writePurchaseKey(int slot, Span auctionId, const uint8_t *token) {
+  if (readEntry(slot) && entryBuffer.hasPurchaseKey && memcmp(entryBuffer.purchaseKey, token, TOKEN_LEN) == 0)
+    return true;                // unchanged key: skip the EEPROM write
+  if (!persistKey(slot, auctionId, REC_PURCHASE_KEY, token)) return false;
+  bufferedSlot = -1;
+  return true;
 }
 
-bool readEntry(int slot) {
-  int addr = slot * ENTRY_SIZE;
-  EEPROM.get(addr, entryBuffer);
-  uint16_t crcCheck = entryCrc(entryBuffer);
-  return (crcCheck == entryBuffer.crc && entryBuffer.used == 1);
+bool writeItemKey(int slot, Span auctionId, const uint8_t *token) {
+  if (readEntry(slot) && entryBuffer.hasItemKey && memcmp(entryBuffer.itemKey, token, TOKEN_LEN) == 0)
+    return true;
+  if (!persistKey(slot, auctionId, REC_ITEM_KEY, token)) return false;
+  bufferedSlot = -1;
+  return true;
 }
 
 // ----------------------------------------------------
 // Hex helpers
 // ----------------------------------------------------
-bool hexToBytes(const String &hex, uint8_t *out) {
-  if (hex.length() < TOKEN_LEN * 2) return false;
-  for (int i = 0; i < TOKEN_LEN; i++) {
-    char c1 = hex[2 * i];
-    char c2 = hex[2 * i + 1];
-    uint8_t v1 = (c1 <= '9') ? c1 - '0' : toupper(c1) - 'A' + 10;
-    uint8_t v2 = (c2 <= '9') ? c2 - '0' : toupper(c2) - 'A' + 10;
-    out[i] = (v1 << 4) | v2;
+#define HEX_BAD 0xFF
+
+// Nibble values for '0'..'f'; anything else is rejected.
+const uint8_t HEX_TABLE[] PROGMEM = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9,                                       // '0'-'9'
+  HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD,      // ':'-'@'
+  10, 11, 12, 13, 14, 15,                                             // 'A'-'F'
+  HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD,
+  HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD,
+  HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD, HEX_BAD,
+  HEX_BAD, HEX_BAD,                                                   // 'G'-'`'
+  10, 11, 12, 13, 14, 15                                              // 'a'-'f'
+};
+
+uint8_t hexNibble(char c) {
+  uint8_t i = (uint8_t)(c - '0');
+  return i < sizeof(HEX_TABLE) ? pgm_read_byte(&HEX_TABLE[i]) : HEX_BAD;
+}
+
+// Decodes the first TOKEN_LEN * 2 characters; anything after them is ignored.
+bool hexToBytes(Span hex, uint8_t *out) {
+  PhaseScope phase(PHASE_PARSE);
+  if (hex.len < TOKEN_LEN * 2) return false;
+  for (uint8_t i = 0; i < TOKEN_LEN; i++) {
+    uint8_t hi = hexNibble(hex.ptr[2 * i]);
+    uint8_t lo = hexNibble(hex.ptr[2 * i + 1]);
+    if ((hi | lo) & 0xF0) return false;
+    out[i] = (hi << 4) | lo;
   }
   return true;
 }
@@ -132,215 +1034,722 @@ bool tokensMatch(const uint8_t *a, const uint8_t *b) {
   return true;
 }
 
-void tokenToHex(const uint8_t *tokenBytes, char *out) {
-  static const char HEX_DIGITS[] = "0123456789ABCDEF";
-  for (int i = 0; i < TOKEN_LEN; i++) {
-    out[i * 2] = HEX_DIGITS[(tokenBytes[i] >> 4) & 0x0F];
-    out[i * 2 + 1] = HEX_DIGITS[tokenBytes[i] & 0x0F];
+const char HEX_DIGITS[] PROGMEM = "0123456789ABCDEF";
+
+void bytesToHex(const uint8_t *bytes, uint8_t len, char *out) {
+  for (uint8_t i = 0; i < len; i++) {
+    out[i * 2] = pgm_read_byte(&HEX_DIGITS[(bytes[i] >> 4) & 0x0F]);
+    out[i * 2 + 1] = pgm_read_byte(&HEX_DIGITS[bytes[i] & 0x0F]);
+  }
+  out[len * 2] = '\0';
+}
+
+// Prints a token as hex straight to serial, without a 65-byte string on the stack.
+void printToken(const uint8_t *tokenBytes) {
+  for (uint8_t i = 0; i < TOKEN_LEN; i++) {
+    serialOut.print((char)pgm_read_byte(&HEX_DIGITS[tokenBytes[i] >> 4]));
+    serialOut.print((char)pgm_read_byte(&HEX_DIGITS[tokenBytes[i] & 0x0F]));
   }
-  out[TOKEN_LEN * 2] = '\0';
+}
+
+// Stable per-chip id for INFO, so a host can tell its controllers apart however
+// the serial ports enumerate: DEVICE_ID from the build flags, the ESP32's
+// factory MAC, or the serial number in the AVR signature row.
+uint8_t deviceId(char *out) {
+#if defined(DEVICE_ID)
+  strncpy(out, DEVICE_ID, DEVICE_ID_LEN);
+  out[DEVICE_ID_LEN] = '\0';
+#elif defined(ESP32)
+  uint64_t mac = ESP.getEfuseMac();
+  bytesToHex(reinterpret_cast<const uint8_t *>(&mac), 6, out);
+#else
+  uint8_t serial[DEVICE_ID_LEN / 2];
+  for (uint8_t i = 0; i < sizeof(serial); i++) serial[i] = boot_signature_byte_get(0x0E + i);
+  bytesToHex(serial, sizeof(serial), out);
+#endif
+  return strlen(out);
 }
 
 // ----------------------------------------------------
-// Command handlers
+// Line parser
 // ----------------------------------------------------
-void handleAdd(String id, String hexToken) {
-  uint8_t token[TOKEN_LEN];
-  if (!hexToBytes(hexToken, token)) {
-    Serial.println("ERR_FORMAT");
-    return;
+Span trimSpan(Span s) {
+  while (s.len && isspace((unsigned char)s.ptr[0])) {
+    s.ptr++;
+    s.len--;
   }
+  while (s.len && isspace((unsigned char)s.ptr[s.len - 1])) s.len--;
+  return s;
+}
 
-  int slot = findSlotByAuction(id);
-  if (slot < 0) {
-    slot = findFreeSlot();
-  }
-  if (slot < 0) {
-    Serial.println("ERR_FULL");
-    return;
-  }
-  writePurchaseKey(slot, id, token);
-  Serial.print("OK_ADD:");
-  Serial.println(id);
+// Command names live in flash (F()), so these compare against PROGMEM text.
+bool spanStartsWith(Span s, const __FlashStringHelper *prefix) {
+  const char *p = reinterpret_cast<const char *>(prefix);
+  uint8_t n = strlen_P(p);
+  return s.len >= n && memcmp_P(s.ptr, p, n) == 0;
 }
 
-void handleItem(String id, String hexToken) {
-  uint8_t token[TOKEN_LEN];
-  if (!hexToBytes(hexToken, token)) {
-    Serial.println("ERR_FORMAT");
-    return;
-  }
+bool spanEquals(Span s, const __FlashStringHelper *text) {
+  const char *p = reinterpret_cast<const char *>(text);
+  return s.len == strlen_P(p) && memcmp_P(s.ptr, p, s.len) == 0;
+}
+
+int spanIndexOf(Span s, char c, uint8_t from) {
+  for (uint8_t i = from; i < s.len; i++)
+    if (s.ptr[i] == c) return i;
+  return -1;
+}
+
+Span spanSlice(Span s, uint8_t from, uint8_t to) {
+  Span out = {s.ptr + from, (uint8_t)(to - from)};
+  return out;
+}
+
+void printSpan(Span s) {
+  serialOut.write(reinterpret_cast<const uint8_t *>(s.ptr), s.len);
+}
+
+// Strips an optional "#<seq>:" tag into replySeq; false if the tag is malformed.
+bool takeSequence(Span &cmd) {
+  PhaseScope phase(PHASE_PARSE);
+  if (!cmd.len || cmd.ptr[0] != '#') return true;
+  uint16_t seq = 0;
+  uint8_t i = 1;
+  while (i < cmd.len && isdigit((unsigned char)cmd.ptr[i]) && seq <= 255) seq = seq * 10 + (cmd.ptr[i++] - '0');
+  if (i == 1 || i >= cmd.len || cmd.ptr[i] != ':' || seq > 255) return false;
+  replySeq = seq;
+  cmd = spanSlice(cmd, i + 1, cmd.len);
+  return true;
+}
 
+// ----------------------------------------------------
+// Escrow operations (shared by the text and binary front ends)
+// ----------------------------------------------------
+uint8_t storeKey(Span id, uint8_t type, const uint8_t *token) {
+  if (!validAuctionId(id)) return ST_ERR_FORMAT;
   int slot = findSlotByAuction(id);
   if (slot < 0) slot = findFreeSlot();
-  if (slot < 0) {
-    Serial.println("ERR_FULL");
-    return;
+  if (slot < 0) return ST_ERR_FULL;
+  bool ok = type == REC_ITEM_KEY ? writeItemKey(slot, id, token) : writePurchaseKey(slot, id, token);
+  return ok ? ST_OK : ST_ERR_FULL;
+}
+
+// On ST_OK the matched keys are left in entryBuffer for the reply and the
+// caller finishes with releaseSlot().
+uint8_t verifyPurchase(Span id, const uint8_t *token, int &slot) {
+  if (!validAuctionId(id)) return ST_ERR_FORMAT;
+  slot = findSlotByAuction(id);
+  if (slot < 0) return ST_ERR_NO_ITEM;
+  if (!readEntry(slot)) return ST_ERR_CORRUPT;
+  if (!entryBuffer.hasPurchaseKey) return ST_ERR_NO_PURCHASE_KEY;
+  if (!tokensMatch(entryBuffer.purchaseKey, token)) {
+    pulsePin(STATUS_LED, PULSE_MS);
+    return ST_ERR_MISMATCH;
   }
+  return ST_OK;
+}
 
-  writeItemKey(slot, id, token);
-  Serial.print("OK_ITEM:");
-  Serial.println(id);
+// Claims a slot before any key is sent; an auction that already has one keeps it.
+// The claim survives reboots and is dropped by ERASE or a release.
+uint8_t reserveAuction(Span id) {
+  if (!validAuctionId(id)) return ST_ERR_FORMAT;
+  if (findSlotByAuction(id) >= 0) return ST_OK;
+  int slot = findFreeSlot();
+  if (slot < 0) return ST_ERR_FULL;
+  return persistReservation(slot, id) ? ST_OK : ST_ERR_FULL;
 }
 
-void handleBuy(String id, String hexToken) {
-  uint8_t token[TOKEN_LEN];
-  if (!hexToBytes(hexToken, token)) {
-    Serial.println("ERR_FORMAT");
-    return;
-  }
+// The release line only pulses once the tombstone is queued, so a key can't
+// release twice; entryBuffer still holds the keys for the reply.
+uint8_t releaseSlot(int slot) {
+  if (!eraseSlot(slot)) return ST_ERR_FULL;
+  pulsePin(RELEASE_PIN, PULSE_MS);
+  return ST_OK;
+}
 
+uint8_t eraseAuction(Span id) {
+  if (!validAuctionId(id)) return ST_ERR_FORMAT;
   int slot = findSlotByAuction(id);
-  if (slot < 0) {
-    Serial.println("ERR_NO_ITEM");
-    return;
-  }
+  if (slot < 0) return ST_ERR_NOT_FOUND;
+  return eraseSlot(slot) ? ST_OK : ST_ERR_FULL;
+}
 
-  if (!readEntry(slot)) {
-    Serial.println("ERR_CORRUPT");
-    return;
+void resetEscrow() {
+  clearAllSlots();
+  cancelTasks();
+  digitalWrite(RELEASE_PIN, LOW);
+  digitalWrite(STATUS_LED, LOW);
+}
+
+// ----------------------------------------------------
+// Command handlers
+// ----------------------------------------------------
+// Tags a reply line with the seq of the command it answers.
+void printSeq() {
+  if (replySeq < 0) return;
+  serialOut.print('#');
+  serialOut.print(replySeq);
+  serialOut.print(':');
+}
+
+// Text reply for a failed operation; the mismatch reply names the auction.
+void printError(uint8_t status, Span id) {
+  errorCount++;
+  printSeq();
+  switch (status) {
+    case ST_ERR_FORMAT: serialOut.println(F("ERR_FORMAT")); break;
+    case ST_ERR_FULL: serialOut.println(F("ERR_FULL")); break;
+    case ST_ERR_NO_ITEM: serialOut.println(F("ERR_NO_ITEM")); break;
+    case ST_ERR_NO_PURCHASE_KEY: serialOut.println(F("ERR_NO_PURCHASE_KEY")); break;
+    case ST_ERR_NOT_FOUND: serialOut.println(F("ERR_NOT_FOUND")); break;
+    case ST_ERR_CORRUPT: serialOut.println(F("ERR_CORRUPT")); break;
+    case ST_ERR_MISMATCH:
+      serialOut.print(F("ERR_MISMATCH:"));
+      printSpan(id);
+      serialOut.println();
+      break;
+    default: serialOut.println(F("ERR_SYNTAX")); break;
   }
+}
+
+// Tagged commands are acknowledged by the next batched ACK instead.
+void printOk(const __FlashStringHelper *prefix, Span id) {
+  if (replySeq >= 0) return;
+  serialOut.print(prefix);
+  printSpan(id);
+  serialOut.println();
+}
+
+void handleAdd(Span id, Span hexToken) {
+  uint8_t token[TOKEN_LEN];
+  uint8_t status = hexToBytes(hexToken, token) ? storeKey(id, REC_PURCHASE_KEY, token) : ST_ERR_FORMAT;
+  if (status == ST_OK) printOk(F("OK_ADD:"), id);
+  else printError(status, id);
+}
+
+void handleItem(Span id, Span hexToken) {
+  uint8_t token[TOKEN_LEN];
+  uint8_t status = hexToBytes(hexToken, token) ? storeKey(id, REC_ITEM_KEY, token) : ST_ERR_FORMAT;
+  if (status == ST_OK) printOk(F("OK_ITEM:"), id);
+  else printError(status, id);
+}
 
-  if (!entryBuffer.hasPurchaseKey) {
-    Serial.println("ERR_NO_PURCHASE_KEY");
+void handleBuy(Span id, Span hexToken) {
+  uint8_t token[TOKEN_LEN];
+  int slot;
+  uint8_t status = hexToBytes(hexToken, token) ? verifyPurchase(id, token, slot) : ST_ERR_FORMAT;
+  if (status == ST_OK) status = releaseSlot(slot);
+  if (status != ST_OK) {
+    printError(status, id);
     return;
   }
 
-  if (tokensMatch(entryBuffer.purchaseKey, token)) {
-    char purchaseHex[TOKEN_LEN * 2 + 1];
-    tokenToHex(entryBuffer.purchaseKey, purchaseHex);
-    Serial.print("OK_RELEASE:");
-    Serial.print(id);
-    Serial.print(':');
-    Serial.print(purchaseHex);
-    if (entryBuffer.hasItemKey) {
-      char itemHex[TOKEN_LEN * 2 + 1];
-      tokenToHex(entryBuffer.itemKey, itemHex);
-      Serial.print(':');
-      Serial.print(itemHex);
-    }
-    Serial.println();
-    digitalWrite(RELEASE_PIN, HIGH);
-    delay(500);
-    digitalWrite(RELEASE_PIN, LOW);
-    eraseSlot(slot);
-  } else {
-    Serial.print("ERR_MISMATCH:");
-    Serial.println(id);
-    digitalWrite(STATUS_LED, HIGH);
-    delay(500);
-    digitalWrite(STATUS_LED, LOW);
+  printSeq();
+  serialOut.print(F("OK_RELEASE:"));
+  printSpan(id);
+  serialOut.print(':');
+  printToken(entryBuffer.purchaseKey);
+  if (entryBuffer.hasItemKey) {
+    serialOut.print(':');
+    printToken(entryBuffer.itemKey);
   }
+  serialOut.println();
 }
 
-void handleErase(String id) {
-  int slot = findSlotByAuction(id);
-  if (slot < 0) {
-    Serial.println("ERR_NOT_FOUND");
-    return;
-  }
-  eraseSlot(slot);
-  Serial.print("OK_ERASE:");
-  Serial.println(id);
+void handleErase(Span id) {
+  uint8_t status = eraseAuction(id);
+  if (status == ST_OK) printOk(F("OK_ERASE:"), id);
+  else printError(status, id);
+}
+
+void handleReserve(Span id) {
+  uint8_t status = reserveAuction(id);
+  if (status == ST_OK) printOk(F("OK_RESERVE:"), id);
+  else printError(status, id);
+}
+
+// INFO:id=<device id>,slots=<n>,used=<n>,free=<n>,log_free=<bytes>,caps=<name>+...
+void handleInfo() {
+  char id[DEVICE_ID_LEN + 1];
+  deviceId(id);
+  uint16_t used = usedSlots();
+  printSeq();
+  serialOut.print(F("INFO:id="));
+  serialOut.print(id);
+  serialOut.print(F(",slots="));
+  serialOut.print(MAX_AUCTIONS);
+  serialOut.print(F(",used="));
+  serialOut.print(used);
+  serialOut.print(F(",free="));
+  serialOut.print(freeAuctions());
+  serialOut.print(F(",log_free="));
+  serialOut.print(logFreeBytes());
+  serialOut.println(F(",caps=SEQ+BINARY+STATS+RESERVE"));
 }
 
 void handleList() {
-  Serial.println("AUCTIONS:");
+  printSeq();
+  serialOut.println(F("AUCTIONS:"));
   for (int i = 0; i < MAX_AUCTIONS; i++) {
-    int addr = i * ENTRY_SIZE;
-    EEPROM.get(addr, entryBuffer);
-    uint16_t crcCheck = entryCrc(entryBuffer);
-    if (entryBuffer.used == 1 && crcCheck == entryBuffer.crc) {
-      Serial.print("  ");
-      Serial.print(entryBuffer.auctionId);
-      Serial.print(" (item=");
-      Serial.print(entryBuffer.hasItemKey ? "Y" : "N");
-      Serial.print(", purchase=");
-      Serial.print(entryBuffer.hasPurchaseKey ? "Y" : "N");
-      Serial.println(")");
+    if (readEntry(i)) {
+      serialOut.print(F("  "));
+      serialOut.print(entryBuffer.auctionId);
+      serialOut.print(F(" (item="));
+      serialOut.print(entryBuffer.hasItemKey ? 'Y' : 'N');
+      serialOut.print(F(", purchase="));
+      serialOut.print(entryBuffer.hasPurchaseKey ? 'Y' : 'N');
+      serialOut.println(F(")"));
     }
   }
 }
 
 void handleReset() {
-  Serial.println("RESETTING ESCROW SYSTEM...");
-  clearAllSlots();
-  digitalWrite(RELEASE_PIN, LOW);
-  digitalWrite(STATUS_LED, LOW);
-  delay(100);
-  Serial.println("EEPROM CLEARED. SYSTEM RESET COMPLETE.");
-  Serial.println("=== Escrow Verification Ready ===");
+  printSeq();
+  serialOut.println(F("RESETTING ESCROW SYSTEM..."));
+  resetEscrow();
+  serialOut.println(F("EEPROM CLEARED. SYSTEM RESET COMPLETE."));
+  serialOut.println(F("=== Escrow Verification Ready ==="));
+}
+
+void handleBinary() {
+  printSeq();
+  serialOut.println(F("OK_BINARY"));
+  binaryMode = true;
+}
+
+const char PHASE_NAMES[PHASE_COUNT][8] PROGMEM = {"parse", "lookup", "crc", "persist", "reply", "total"};
+const char COMMAND_NAMES[16][8] PROGMEM = {"OTHER", "ADD", "ITEM", "BUY", "ERASE", "LIST", "RESET", "KEYS",
+                                           "SYNC", "", "", "INFO", "RESERVE", "", "", "MODE"};
+
+// STATS report, shared by both front ends:
+//   STATS:uptime_s=<s>,cmds=<n>,errors=<n>
+//     RX:serial_peak=<bytes>,inbox_peak=<lines>,queue_peak=<writes>
+//     SRAM:free=<bytes>,low=<bytes>
+//     CMD:<name>=<n>,...                    (commands seen, by kind)
+//     PHASE:<name>:n=<n>,sum_us=<us>,max_us=<us>,hist=<b0>/.../<b7>
+//     EEPROM:<cells written to page 0>,<page 1>,...
+//   END_STATS
+void printStats(Print &out) {
+  uint32_t commands = 0;
+  for (uint8_t i = 0; i < 16; i++) commands += commandCounts[i];
+  uint16_t spare = freeSram();
+  out.print(F("STATS:uptime_s="));
+  out.print(millis() / 1000);
+  out.print(F(",cmds="));
+  out.print(commands);
+  out.print(F(",errors="));
+  out.println(errorCount);
+
+  out.print(F("  RX:serial_peak="));
+  out.print(rxPeak);
+  out.print(F(",inbox_peak="));
+  out.print(inboxPeak);
+  out.print(F(",queue_peak="));
+  out.println(queuePeak);
+  out.print(F("  SRAM:free="));
+  out.print(spare);
+  out.print(F(",low="));
+  out.println(sramLow < spare ? sramLow : spare);
+
+  out.print(F("  CMD:"));
+  bool first = true;
+  for (uint8_t op = 0; op < 16; op++) {
+    if (!pgm_read_byte(&COMMAND_NAMES[op][0])) continue;
+    if (!first) out.print(',');
+    first = false;
+    out.print(reinterpret_cast<const __FlashStringHelper *>(COMMAND_NAMES[op]));
+    out.print('=');
+    out.print(commandCounts[op]);
+  }
+  out.println();
+
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    const PhaseStats &ps = phaseStats[p];
+    out.print(F("  PHASE:"));
+    out.print(reinterpret_cast<const __FlashStringHelper *>(PHASE_NAMES[p]));
+    out.print(F(":n="));
+    out.print(ps.count);
+    out.print(F(",sum_us="));
+    out.print(ps.totalMicros);
+    out.print(F(",max_us="));
+    out.print(ps.maxMicros);
+    out.print(F(",hist="));
+    for (uint8_t b = 0; b < HIST_BUCKETS; b++) {
+      if (b) out.print('/');
+      out.print(ps.histogram[b]);
+    }
+    out.println();
+  }
+
+  out.print(F("  EEPROM:"));
+  for (uint8_t page = 0; page < LOG_PAGES; page++) {
+    if (page) out.print(',');
+    out.print(pageWrites[page]);
+  }
+  out.println();
+  out.println(F("END_STATS"));
+}
+
+// STATS:RESET reports, then starts a fresh window, so a scraper sees deltas.
+void handleStats(bool reset) {
+  printSeq();
+  printStats(serialOut);
+  if (reset) resetStats();
 }
 
 // ----------------------------------------------------
-// Setup & loop
+// Binary framing
 // ----------------------------------------------------
-void setup() {
-  Serial.begin(115200);
-  pinMode(STATUS_LED, OUTPUT);
-  pinMode(RELEASE_PIN, OUTPUT);
-  digitalWrite(RELEASE_PIN, LOW);
-  Serial.println("=== Escrow Verification Ready ===");
+// Decodes a COBS frame in place; returns the decoded length or 0 if malformed.
+uint8_t cobsDecode(uint8_t *buf, uint8_t len) {
+  PhaseScope phase(PHASE_PARSE);
+  uint8_t in = 0, out = 0;
+  while (in < len) {
+    uint8_t code = buf[in++];
+    if (code == 0 || in + code - 1 > len) return 0;
+    for (uint8_t i = 1; i < code; i++) buf[out++] = buf[in++];
+    if (code != 0xFF && in < len) buf[out++] = 0;
+  }
+  return out;
 }
 
-void loop() {
-  if (Serial.available()) {
-    String cmd = Serial.readStringUntil('\n');
-    cmd.trim();
-    if (cmd.length() == 0) {
+// Encodes len bytes of src into frameBuffer, zero delimiter included.
+uint8_t cobsEncode(const uint8_t *src, uint8_t len) {
+  uint8_t out = 1, codeAt = 0, code = 1;
+  for (uint8_t i = 0; i < len; i++) {
+    if (src[i] == 0) {
+      frameBuffer[codeAt] = code;
+      codeAt = out++;
+      code = 1;
       continue;
     }
-
-    if (cmd.startsWith("ADD:")) {
-      int c1 = cmd.indexOf(':', 4);
-      if (c1 == -1) { Serial.println("ERR_SYNTAX"); return; }
-      String id = cmd.substring(4, c1);
-      String token = cmd.substring(c1 + 1);
-      handleAdd(id, token);
+    frameBuffer[out++] = src[i];
+    if (++code == 0xFF) {
+      frameBuffer[codeAt] = code;
+      codeAt = out++;
+      code = 1;
     }
-    else if (cmd.startsWith("ITEM:")) {
-      int c1 = cmd.indexOf(':', 5);
-      if (c1 == -1) { Serial.println("ERR_SYNTAX"); continue; }
-      String id = cmd.substring(5, c1);
-      String token = cmd.substring(c1 + 1);
-      handleItem(id, token);
+  }
+  frameBuffer[codeAt] = code;
+  frameBuffer[out++] = 0;
+  return out;
+}
+
+// Reply frames are staged in replyBuffer as [len][op|0x80][seq?][status][payload...].
+uint8_t replyLength;
+
+void beginReply(uint8_t op, uint8_t status) {
+  if (status != ST_OK && status != ST_DONE) errorCount++;
+  replyLength = 1;
+  replyBuffer[replyLength++] = op | OP_REPLY | (replySeq >= 0 ? OP_SEQ : 0);
+  if (replySeq >= 0) replyBuffer[replyLength++] = replySeq;
+  replyBuffer[replyLength++] = status;
+}
+
+void replyBytes(const void *data, uint8_t len) {
+  memcpy(replyBuffer + replyLength, data, len);
+  replyLength += len;
+}
+
+void replyId(Span id) {
+  replyBuffer[replyLength++] = id.len;
+  replyBytes(id.ptr, id.len);
+}
+
+void sendReply() {
+  replyBuffer[0] = replyLength - 1;
+  uint16_t crc = computeCRC(replyBuffer, replyLength);
+  replyBuffer[replyLength++] = crc & 0xFF;
+  replyBuffer[replyLength++] = crc >> 8;
+  serialOut.write(frameBuffer, cobsEncode(replyBuffer, replyLength));
+}
+
+// A tagged command's OK is left to the next batched ACK.
+void sendStatus(uint8_t op, uint8_t status, Span id) {
+  if (status == ST_OK && replySeq >= 0) return;
+  beginReply(op, status);
+  replyId(id);
+  sendReply();
+}
+
+// Print sink that streams text into OP_STATS reply frames: one frame per line,
+// or per full frame for longer lines, with '\n' kept and '\r' dropped.
+struct FramePrint : public Print {
+  size_t write(uint8_t c) override {
+    if (c == '\r') return 1;
+    if (replyLength == 1) beginReply(OP_STATS, ST_OK);
+    replyBuffer[replyLength++] = c;
+    if (c == '\n' || replyLength == MAX_REPLY_SIZE - 2) {
+      sendReply();
+      replyLength = 1;
     }
-    else if (cmd.startsWith("BUY:")) {
-      int c1 = cmd.indexOf(':', 4);
-      if (c1 == -1) { Serial.println("ERR_SYNTAX"); continue; }
-      String id = cmd.substring(4, c1);
-      String token = cmd.substring(c1 + 1);
-      handleBuy(id, token);
+    return 1;
+  }
+  using Print::write;
+};
+
+void sendStats(bool reset) {
+  FramePrint frames;
+  replyLength = 1;
+  printStats(frames);
+  sendStatus(OP_STATS, ST_DONE, {"", 0});
+  if (reset) resetStats();
+}
+
+// Validates a decoded frame [len][op][payload][crc16] and runs it.
+void dispatchFrame(uint8_t *frame, uint8_t size) {
+  Span none = {"", 0};
+  if (size < 4 || frame[0] != size - 3 ||
+      computeCRC(frame, size - 2) != (frame[size - 2] | ((uint16_t)frame[size - 1] << 8))) {
+    sendStatus(0, ST_ERR_SYNTAX, none);
+    return;
+  }
+
+  uint8_t op = frame[1];
+  const uint8_t *payload = frame + 2;
+  uint8_t payloadLen = size - 4;
+  if (op & OP_SEQ) {
+    if (!payloadLen) {
+      sendStatus(0, ST_ERR_SYNTAX, none);
+      return;
     }
-    else if (cmd.startsWith("ERASE:")) {
-      String id = cmd.substring(6);
-      handleErase(id);
+    op &= ~OP_SEQ;
+    replySeq = payload[0];
+    payload++;
+    payloadLen--;
+  }
+  dispatchedOp = op < 16 ? op : 0;
+  Span id = none;
+  const uint8_t *token = nullptr;
+  uint8_t tokens = op == OP_KEYS ? 2 : (op == OP_ADD || op == OP_ITEM || op == OP_BUY) ? 1 : 0;
+  if (op == OP_ERASE || op == OP_RESERVE || tokens) {
+    if (payloadLen < 1 || payload[0] > AUCTION_ID_LEN || payloadLen != 1 + payload[0] + tokens * TOKEN_LEN) {
+      sendStatus(op, ST_ERR_FORMAT, none);
+      return;
     }
-    else if (cmd == "LIST") {
-      handleList();
+    id.ptr = reinterpret_cast<const char *>(payload + 1);
+    id.len = payload[0];
+    token = payload + 1 + id.len;
+  }
+
+  switch (op) {
+    case OP_ADD:
+      sendStatus(op, storeKey(id, REC_PURCHASE_KEY, token), id);
+      break;
+    case OP_ITEM:
+      sendStatus(op, storeKey(id, REC_ITEM_KEY, token), id);
+      break;
+    case OP_KEYS: {
+      uint8_t status = storeKey(id, REC_ITEM_KEY, token);
+      if (status == ST_OK) status = storeKey(id, REC_PURCHASE_KEY, token + TOKEN_LEN);
+      sendStatus(op, status, id);
+      break;
     }
-    else if (cmd == "RESET") {
-      handleReset();
+    case OP_BUY: {
+      int slot;
+      uint8_t status = verifyPurchase(id, token, slot);
+      if (status == ST_OK) status = releaseSlot(slot);
+      beginReply(op, status);
+      replyId(id);
+      if (status == ST_OK) {
+        replyBytes(entryBuffer.purchaseKey, TOKEN_LEN);
+        if (entryBuffer.hasItemKey) replyBytes(entryBuffer.itemKey, TOKEN_LEN);
+      }
+      sendReply();
+      break;
     }
-    else {
-      Serial.print("ERR_UNKNOWN_CMD:");
-      Serial.println(cmd);
+    case OP_ERASE:
+      sendStatus(op, eraseAuction(id), id);
+      break;
+    case OP_RESERVE:
+      sendStatus(op, reserveAuction(id), id);
+      break;
+    case OP_INFO: {
+      char deviceHex[DEVICE_ID_LEN + 1];
+      uint16_t info[4] = {MAX_AUCTIONS, usedSlots(), freeAuctions(), logFreeBytes()};
+      beginReply(op, ST_OK);
+      replyId({deviceHex, deviceId(deviceHex)});
+      for (uint8_t i = 0; i < 4; i++) {
+        replyBuffer[replyLength++] = info[i] & 0xFF;
+        replyBuffer[replyLength++] = info[i] >> 8;
+      }
+      replyBuffer[replyLength++] = FIRMWARE_CAPS;
+      sendReply();
+      break;
     }
+    case OP_LIST:
+      for (int i = 0; i < MAX_AUCTIONS; i++) {
+        if (!readEntry(i)) continue;
+        Span entryId = {entryBuffer.auctionId, (uint8_t)strlen(entryBuffer.auctionId)};
+        beginReply(op, ST_OK);
+        replyId(entryId);
+        replyBuffer[replyLength++] = (entryBuffer.hasItemKey ? 1 : 0) | (entryBuffer.hasPurchaseKey ? 2 : 0);
+        sendReply();
+      }
+      sendStatus(op, ST_DONE, none);
+      break;
+    case OP_RESET:
+      resetEscrow();
+      sendStatus(op, ST_OK, none);
+      break;
+    case OP_SYNC:
+      syncRequested = true;
+      break;
+    case OP_STATS:
+      sendStats(payloadLen && payload[0]);
+      break;
+    case OP_TEXT:
+      sendStatus(op, ST_OK, none);
+      binaryMode = false;
+      break;
+    default:
+      dispatchedOp = 0;
+      sendStatus(op, ST_ERR_UNKNOWN_CMD, none);
+      break;
+  }
+}
+
+// ----------------------------------------------------
+// Setup & loop
+// ----------------------------------------------------
+void setup() {
+  Serial.begin(115200);
+  pinMode(STATUS_LED, OUTPUT);
+  pinMode(RELEASE_PIN, OUTPUT);
+  digitalWrite(RELEASE_PIN, LOW);
+#ifdef ESP32
+  EEPROM.begin(STORE_BYTES);
+#endif
+  mountStore();
+  binaryMode = false;
+  inboxUsed = inboxCount = lineLength = rxLines = 0;
+  lineOverflow = false;
+  ackCount = 0;
+  syncRequested = false;
+  resetStats();
+  serialOut.println(F("=== Escrow Verification Ready ==="));
+}
+
+void dispatchCommand(Span cmd) {
+  if (!takeSequence(cmd)) {
+    printError(ST_ERR_SYNTAX, cmd);
+    return;
+  }
+  if (spanStartsWith(cmd, F("ADD:"))) {
+    dispatchedOp = OP_ADD;
+    int c1 = spanIndexOf(cmd, ':', 4);
+    if (c1 == -1) { printError(ST_ERR_SYNTAX, cmd); return; }
+    handleAdd(spanSlice(cmd, 4, c1), spanSlice(cmd, c1 + 1, cmd.len));
+  }
+  else if (spanStartsWith(cmd, F("ITEM:"))) {
+    dispatchedOp = OP_ITEM;
+    int c1 = spanIndexOf(cmd, ':', 5);
+    if (c1 == -1) { printError(ST_ERR_SYNTAX, cmd); return; }
+    handleItem(spanSlice(cmd, 5, c1), spanSlice(cmd, c1 + 1, cmd.len));
+  }
+  else if (spanStartsWith(cmd, F("BUY:"))) {
+    dispatchedOp = OP_BUY;
+    int c1 = spanIndexOf(cmd, ':', 4);
+    if (c1 == -1) { printError(ST_ERR_SYNTAX, cmd); return; }
+    handleBuy(spanSlice(cmd, 4, c1), spanSlice(cmd, c1 + 1, cmd.len));
+  }
+  else if (spanStartsWith(cmd, F("ERASE:"))) {
+    dispatchedOp = OP_ERASE;
+    handleErase(spanSlice(cmd, 6, cmd.len));
+  }
+  else if (spanStartsWith(cmd, F("RESERVE:"))) {
+    dispatchedOp = OP_RESERVE;
+    handleReserve(spanSlice(cmd, 8, cmd.len));
+  }
+  else if (spanEquals(cmd, F("INFO"))) {
+    dispatchedOp = OP_INFO;
+    handleInfo();
+  }
+  else if (spanEquals(cmd, F("LIST"))) {
+    dispatchedOp = OP_LIST;
+    handleList();
+  }
+  else if (spanEquals(cmd, F("RESET"))) {
+    dispatchedOp = OP_RESET;
+    handleReset();
+  }
+  else if (spanEquals(cmd, F("BINARY"))) {
+    dispatchedOp = OP_TEXT;
+    handleBinary();
+  }
+  else if (spanEquals(cmd, F("SYNC"))) {
+    dispatchedOp = OP_SYNC;
+    syncRequested = true;
+  }
+  else if (spanEquals(cmd, F("STATS")) || spanEquals(cmd, F("STATS:RESET"))) {
+    dispatchedOp = OP_STATS;
+    handleStats(cmd.len > 5);
+  }
+  else {
+    errorCount++;
+    printSeq();
+    serialOut.print(F("ERR_UNKNOWN_CMD:"));
+    printSpan(cmd);
+    serialOut.println();
   }
 }
-void writeItemKey(int slot, const String &auctionId, const uint8_t *token) {
-  Entry entry;
-  bool existing = readEntry(slot);
-  if (existing) {
-    entry = entryBuffer;
+
+// Reports tagged commands completed since the last ACK and the credit limit.
+void sendAck(bool sync) {
+  if (binaryMode) {
+    beginReply(sync ? OP_SYNC : OP_ACK, ST_OK);
+    replyBuffer[replyLength++] = ackSeq;
+    replyBuffer[replyLength++] = ackCount;
+    replyBuffer[replyLength++] = creditLimit();
+    sendReply();
   } else {
-    memset(&entry, 0, sizeof(entry));
-    entry.used = 1;
-    strncpy(entry.auctionId, auctionId.c_str(), AUCTION_ID_LEN);
-    entry.auctionId[AUCTION_ID_LEN] = '\0';
+    serialOut.print(sync ? F("SYNC:") : F("ACK:"));
+    serialOut.print(ackSeq);
+    serialOut.print(':');
+    serialOut.print(ackCount);
+    serialOut.print(':');
+    serialOut.println(creditLimit());
+  }
+  ackCount = 0;
+}
+
+void dispatchLine() {
+  uint8_t length = inbox[0];
+  if (binaryMode) {
+    uint8_t *frame = reinterpret_cast<uint8_t *>(inbox + 1);
+    if (length == LINE_OVERFLOW) sendStatus(0, ST_ERR_SYNTAX, {"", 0});
+    else dispatchFrame(frame, cobsDecode(frame, length));
+    return;
   }
 
-  for (int i = 0; i < TOKEN_LEN; i++) entry.itemKey[i] = token[i];
-  entry.hasItemKey = true;
-  persistEntry(slot, entry);
+  Span cmd = {inbox + 1, length == LINE_OVERFLOW ? (uint8_t)0 : length};
+  cmd = trimSpan(cmd);
+  if (length == LINE_OVERFLOW) printError(ST_ERR_SYNTAX, cmd);
+  else if (cmd.len) dispatchCommand(cmd);
+}
+
+void loop() {
+  runTasks();
+  serviceWriteQueue();
+  pumpSerial();
+  if (!inboxCount) return;
+
+  // The head line stays in place until dispatch returns: spans point into it.
+  beginCommandStats();
+  dispatchLine();
+  endCommandStats();
+  dropLine();
+
+  if (replySeq >= 0) {
+    ackSeq = replySeq;
+    ackCount++;
+    replySeq = -1;
+  }
+  if (syncRequested) {
+    syncRequested = false;
+    rxLines = inboxCount;
+    sendAck(true);
+  } else if (ackCount && (!inboxCount || ackCount >= ACK_BATCH)) {
+    sendAck(false);
+  }
 }
@@ -0,0 +1,896 @@
+/*
+  Host microbenchmarks for the escrow firmware hot paths (env:native).
+  Each command is pushed through loop() exactly as it would arrive over Serial;
+  the report lists host latency, TSC cycles (x86 only) and EEPROM cells
+  programmed per operation. The test_* cases check record log and protocol
+  behaviour over the same harness. Run with: pio test -e native -f bench_escrow -v
+*/
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+// Firmware internals under test (mirrors src/main.cpp)
+struct Span {
+  const char *ptr;
+  uint8_t len;
+};
+
+uint16_t computeCRC(const uint8_t *data, uint16_t len);
+bool hexToBytes(Span hex, uint8_t *out);
+int findSlotByAuction(Span id);
+uint8_t cobsEncode(const uint8_t *src, uint8_t len);
+uint8_t cobsDecode(uint8_t *buf, uint8_t len);
+extern uint8_t frameBuffer[];
+
+static Span span(const char *s) {
+  Span out = {s, (uint8_t)strlen(s)};
+  return out;
+}
+
+static const int ITERATIONS = 2000;
+static const char TOKEN_A[] = "00112233445566778899AABBCCDDEEFF00112233445566778899AABBCCDDEEFF";
+static const char TOKEN_B[] = "FFEEDDCCBBAA99887766554433221100FFEEDDCCBBAA99887766554433221100";
+
+struct BenchResult {
+  unsigned long ops;
+  double nanos;
+  double cycles;
+  unsigned long eepromCells;
+};
+
+struct BenchTimer {
+  std::chrono::steady_clock::time_point start;
+  unsigned long long tsc;
+  unsigned long cells;
+
+  void begin() {
+    cells = native::eepromStats().cellsWritten;
+#ifdef BENCH_HAVE_TSC
+    tsc = __rdtsc();
+#endif
+    start = std::chrono::steady_clock::now();
+  }
+
+  void end(BenchResult &r) {
+    auto stop = std::chrono::steady_clock::now();
+#ifdef BENCH_HAVE_TSC
+    r.cycles += (double)(__rdtsc() - tsc);
+#endif
+    r.nanos += std::chrono::duration<double, std::nano>(stop - start).count();
+    r.eepromCells += native::eepromStats().cellsWritten - cells;
+    r.ops++;
+  }
+};
+
+static void report(const char *name, const BenchResult &r) {
+  double ops = r.ops ? (double)r.ops : 1.0;
+  printf("bench %-22s %10.1f ns/op", name, r.nanos / ops);
+#ifdef BENCH_HAVE_TSC
+  printf(" %12.0f cycles/op", r.cycles / ops);
+#endif
+  printf(" %8.1f eeprom B/op\n", (double)r.eepromCells / ops);
+}
+
+static std::string runCommand(const char *line) {
+  native::serialFeed(line);
+  native::serialFeed("\n");
+  while (native::serialPending() > 0) loop();
+  loop();                       // idle pass: background EEPROM writes land here
+  return native::serialTakeOutput();
+}
+
+static void auctionId(char *out, int n) { snprintf(out, 16, "AUC%08d", n % 100000000); }
+
+static void assertReply(const std::string &reply, const char *prefix) {
+  TEST_ASSERT_EQUAL_STRING_LEN(prefix, reply.c_str(), strlen(prefix));
+}
+
+// Each benchmark boots the firmware against a blank EEPROM.
+void setUp() {
+  native::eepromFill(0xFF);
+  setup();
+  native::eepromResetStats();
+  native::serialClearOutput();
+}
+
+void tearDown() {}
+
+// ----------------------------------------------------
+// Primitive benchmarks
+// ----------------------------------------------------
+void bench_compute_crc() {
+  uint8_t block[96];
+  for (unsigned i = 0; i < sizeof(block); i++) block[i] = (uint8_t)(i * 37);
+  BenchResult r = {};
+  BenchTimer t;
+  volatile uint16_t sink = 0;
+  for (int i = 0; i < ITERATIONS; i++) {
+    block[0] = (uint8_t)i;
+    t.begin();
+    sink = sink + computeCRC(block, sizeof(block));
+    t.end(r);
+  }
+  report("computeCRC(96B)", r);
+}
+
+void bench_hex_to_bytes() {
+  Span hex = span(TOKEN_A);
+  uint8_t out[32];
+  BenchResult r = {};
+  BenchTimer t;
+  for (int i = 0; i < ITERATIONS; i++) {
+    t.begin();
+    bool ok = hexToBytes(hex, out);
+    t.end(r);
+    TEST_ASSERT_TRUE(ok);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0xFF, out[15]);
+  report("hexToBytes", r);
+}
+
+void bench_find_slot() {
+  char line[96];
+  char id[16];
+  int stored = 0;
+  for (;; stored++) {
+    auctionId(id, stored);
+    snprintf(line, sizeof(line), "ITEM:%s:%s", id, TOKEN_A);
+    if (runCommand(line).rfind("OK_ITEM:", 0) != 0) break;
+  }
+  TEST_ASSERT_TRUE(stored > 0);
+
+  BenchResult hit = {}, miss = {};
+  BenchTimer t;
+  auctionId(id, stored - 1);
+  Span last = span(id);
+  Span absent = span("MISSING");
+  for (int i = 0; i < ITERATIONS; i++) {
+    t.begin();
+    int slot = findSlotByAuction(last);
+    t.end(hit);
+    TEST_ASSERT_TRUE(slot >= 0);
+
+    t.begin();
+    slot = findSlotByAuction(absent);
+    t.end(miss);
+    TEST_ASSERT_EQUAL_INT(-1, slot);
+  }
+  printf("bench table capacity: %d auctions\n", stored);
+  report("findSlot(last)", hit);
+  report("findSlot(miss)", miss);
+}
+
+// ----------------------------------------------------
+// End-to-end command benchmarks (parse + lookup + persist + reply)
+// ----------------------------------------------------
+void bench_command_cycle() {
+  BenchResult item = {}, add = {}, buy = {}, mismatch = {};
+  BenchTimer t;
+  char line[96];
+  char id[16];
+  for (int i = 0; i < ITERATIONS; i++) {
+    auctionId(id, i);
+
+    snprintf(line, sizeof(line), "ITEM:%s:%s", id, TOKEN_A);
+    t.begin();
+    std::string reply = runCommand(line);
+    t.end(item);
+    assertReply(reply, "OK_ITEM:");
+
+    snprintf(line, sizeof(line), "ADD:%s:%s", id, TOKEN_B);
+    t.begin();
+    reply = runCommand(line);
+    t.end(add);
+    assertReply(reply, "OK_ADD:");
+
+    snprintf(line, sizeof(line), "BUY:%s:%s", id, TOKEN_A);
+    t.begin();
+    reply = runCommand(line);
+    t.end(mismatch);
+    assertReply(reply, "ERR_MISMATCH:");
+
+    snprintf(line, sizeof(line), "BUY:%s:%s", id, TOKEN_B);
+    t.begin();
+    reply = runCommand(line);
+    t.end(buy);
+    assertReply(reply, "OK_RELEASE:");
+  }
+  report("ITEM", item);
+  report("ADD", add);
+  report("BUY(mismatch)", mismatch);
+  report("BUY(release)", buy);
+}
+
+// ----------------------------------------------------
+// Key sync over the text protocol vs binary mode
+// ----------------------------------------------------
+static std::string runFrame(const uint8_t *body, uint8_t len, size_t &wireBytes) {
+  uint8_t frame[128];
+  memcpy(frame, body, len);
+  uint16_t crc = computeCRC(frame, len);
+  frame[len] = crc & 0xFF;
+  frame[len + 1] = crc >> 8;
+  uint8_t encoded = cobsEncode(frame, len + 2);
+  native::serialFeed(reinterpret_cast<const char *>(frameBuffer), encoded);
+  while (native::serialPending() > 0) loop();
+  loop();
+  std::string reply = native::serialTakeOutput();
+  wireBytes += encoded + reply.size();
+  return reply;
+}
+
+void bench_key_sync_wire() {
+  static const long BAUD = 115200;
+  BenchResult text = {}, binary = {};
+  BenchTimer t;
+  size_t textBytes = 0, binaryBytes = 0;
+  char line[96];
+  char id[16];
+  uint8_t token[32];
+  for (int i = 0; i < 32; i++) token[i] = (uint8_t)(0x11 * (i & 15));
+
+  for (int i = 0; i < ITERATIONS; i++) {
+    auctionId(id, i % 4);
+    t.begin();
+    snprintf(line, sizeof(line), "ITEM:%s:%s\n", id, TOKEN_A);
+    textBytes += strlen(line) + runCommand(line).size() - 1;
+    snprintf(line, sizeof(line), "ADD:%s:%s\n", id, TOKEN_B);
+    textBytes += strlen(line) + runCommand(line).size() - 1;
+    t.end(text);
+  }
+
+  runCommand("BINARY");
+  for (int i = 0; i < ITERATIONS; i++) {
+    auctionId(id, i % 4);
+    uint8_t idLen = strlen(id);
+    uint8_t body[2 + 1 + 12 + 64];
+    uint8_t n = 0;
+    body[n++] = 0;                    // len, patched below
+    body[n++] = 0x07;                 // OP_KEYS
+    body[n++] = idLen;
+    memcpy(body + n, id, idLen);
+    n += idLen;
+    memcpy(body + n, token, 32);
+    n += 32;
+    memcpy(body + n, token, 32);
+    n += 32;
+    body[0] = n - 1;
+    t.begin();
+    std::string reply = runFrame(body, n, binaryBytes);
+    t.end(binary);
+    uint8_t decoded[128];
+    memcpy(decoded, reply.data(), reply.size());
+    TEST_ASSERT_TRUE(cobsDecode(decoded, reply.size() - 1) >= 3);
+    TEST_ASSERT_EQUAL_HEX8(0x87, decoded[1]);  // OP_KEYS | OP_REPLY
+    TEST_ASSERT_EQUAL_HEX8(0x00, decoded[2]);  // ST_OK
+  }
+
+  double textPerSync = (double)textBytes / ITERATIONS;
+  double binaryPerSync = (double)binaryBytes / ITERATIONS;
+  report("sync(text ITEM+ADD)", text);
+  report("sync(binary KEYS)", binary);
+  printf("bench wire bytes/sync: text %.1f, binary %.1f -> %.0f vs %.0f syncs/s at %ld baud (%.2fx)\n",
+         textPerSync, binaryPerSync, BAUD / 10.0 / textPerSync, BAUD / 10.0 / binaryPerSync, BAUD,
+         textPerSync / binaryPerSync);
+}
+
+// ----------------------------------------------------
+// Replay after reboot: stop-and-wait vs sequenced, credit-windowed pipeline
+// ----------------------------------------------------
+// Host bytes reach the controller 16 at a time through a 64-byte RX ring, one
+// loop() per chunk. A turnaround is a point where the host has commands left
+// but must wait for a reply before sending more.
+static const int REPLAY_AUCTIONS = 6;        // ITEM + ADD each; fits the 1 KB log
+static const size_t WIRE_CHUNK = 16;
+
+struct Link {
+  std::string pending;            // host bytes not yet on the wire
+  std::string received;           // controller output not yet split into lines
+  size_t wireBytes;
+
+  void send(const std::string &line) {
+    pending += line;
+    wireBytes += line.size();
+  }
+
+  void step() {
+    size_t n = pending.size() < WIRE_CHUNK ? pending.size() : WIRE_CHUNK;
+    native::serialFeed(pending.data(), n);
+    pending.erase(0, n);
+    loop();
+    std::string out = native::serialTakeOutput();
+    wireBytes += out.size();
+    received += out;
+  }
+
+  bool takeLine(std::string &line) {
+    size_t end = received.find('\n');
+    if (end == std::string::npos) return false;
+    line = received.substr(0, end);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    received.erase(0, end + 1);
+    return true;
+  }
+};
+
+static void replayLine(char *line, size_t size, int i, int seq) {
+  char id[16];
+  auctionId(id, i / 2);
+  int n = seq < 0 ? 0 : snprintf(line, size, "#%d:", seq);
+  snprintf(line + n, size - n, "%s:%s:%s\n", i % 2 ? "ADD" : "ITEM", id, i % 2 ? TOKEN_B : TOKEN_A);
+}
+
+void bench_pipelined_replay() {
+  static const int COMMANDS = REPLAY_AUCTIONS * 2;
+  char line[112];
+  for (int i = 0; i < COMMANDS; i++) {
+    replayLine(line, sizeof(line), i, -1);
+    assertReply(runCommand(line), "OK_");
+  }
+  native::setSerialRxCapacity(64);
+
+  // Stop-and-wait: one command, one reply.
+  setup();
+  native::serialClearOutput();
+  Link plain = {};
+  std::string reply;
+  BenchResult plainTime = {}, pipeTime = {};
+  BenchTimer t;
+  t.begin();
+  for (int i = 0; i < COMMANDS; i++) {
+    replayLine(line, sizeof(line), i, -1);
+    plain.send(line);
+    while (!plain.takeLine(reply)) plain.step();
+    TEST_ASSERT_EQUAL_STRING_LEN("OK_", reply.c_str(), 3);
+  }
+  t.end(plainTime);
+
+  // Pipelined: tagged commands sent while the advertised credit allows.
+  setup();
+  native::serialClearOutput();
+  Link pipe = {};
+  pipe.send("SYNC\n");
+  while (!pipe.takeLine(reply)) pipe.step();
+  unsigned seq, count, limit;
+  TEST_ASSERT_EQUAL_INT(3, sscanf(reply.c_str(), "SYNC:%u:%u:%u", &seq, &count, &limit));
+  uint8_t txLines = 0;
+  int next = 0, acked = 0, turnarounds = 0;
+  bool waiting = false;
+  t.begin();
+  while (acked < COMMANDS) {
+    while (next < COMMANDS && (int8_t)((uint8_t)limit - txLines) > 0) {
+      replayLine(line, sizeof(line), next, next);
+      pipe.send(line);
+      next++;
+      txLines++;
+    }
+    bool stalled = next < COMMANDS && pipe.pending.empty();
+    if (stalled && !waiting) turnarounds++;
+    waiting = stalled;
+
+    pipe.step();
+    while (pipe.takeLine(reply)) {
+      TEST_ASSERT_EQUAL_INT_MESSAGE(3, sscanf(reply.c_str(), "ACK:%u:%u:%u", &seq, &count, &limit), reply.c_str());
+      acked += count;
+      TEST_ASSERT_EQUAL_UINT(acked - 1, seq);
+    }
+  }
+  t.end(pipeTime);
+  TEST_ASSERT_EQUAL_UINT(0, native::serialDropped());
+  native::setSerialRxCapacity(0);
+
+  printf("bench replay %d cmds: stop-and-wait %.1f B/cmd, %d turnarounds (%.0f us); "
+         "pipelined %.1f B/cmd, %d turnarounds (%.0f us)\n",
+         COMMANDS, (double)plain.wireBytes / COMMANDS, COMMANDS, plainTime.nanos / 1000,
+         (double)pipe.wireBytes / COMMANDS, turnarounds, pipeTime.nanos / 1000);
+}
+
+// ----------------------------------------------------
+// STATS telemetry: where a release cycle spends its time
+// ----------------------------------------------------
+void bench_stats_breakdown() {
+  static const int CYCLES = 200;
+  static const char *const PHASES[] = {"parse", "lookup", "crc", "persist", "reply", "total"};
+  char line[96];
+  char id[16];
+  for (int i = 0; i < CYCLES; i++) {
+    auctionId(id, i);
+    snprintf(line, sizeof(line), "ITEM:%s:%s", id, TOKEN_A);
+    runCommand(line);
+    snprintf(line, sizeof(line), "ADD:%s:%s", id, TOKEN_B);
+    runCommand(line);
+    snprintf(line, sizeof(line), "BUY:%s:%s", id, TOKEN_A);
+    runCommand(line);
+    snprintf(line, sizeof(line), "BUY:%s:%s", id, TOKEN_B);
+    runCommand(line);
+  }
+
+  std::string stats = runCommand("STATS:RESET");
+  unsigned long uptime, cmds, errors;
+  TEST_ASSERT_EQUAL_INT(3, sscanf(stats.c_str(), "STATS:uptime_s=%lu,cmds=%lu,errors=%lu", &uptime, &cmds, &errors));
+  TEST_ASSERT_EQUAL_UINT(CYCLES * 4, cmds);
+  TEST_ASSERT_EQUAL_UINT(CYCLES, errors);
+  TEST_ASSERT_NOT_NULL(strstr(stats.c_str(), "ADD=200,ITEM=200,BUY=400"));
+
+  unsigned long n[6], sum[6], maxUs[6];
+  for (int p = 0; p < 6; p++) {
+    char key[24];
+    snprintf(key, sizeof(key), "PHASE:%s:", PHASES[p]);
+    const char *at = strstr(stats.c_str(), key);
+    TEST_ASSERT_NOT_NULL(at);
+    TEST_ASSERT_EQUAL_INT(3, sscanf(at + strlen(key), "n=%lu,sum_us=%lu,max_us=%lu", &n[p], &sum[p], &maxUs[p]));
+  }
+  TEST_ASSERT_EQUAL_UINT(CYCLES * 4, n[5]);
+  TEST_ASSERT_EQUAL_UINT(CYCLES * 3, n[3]);     // the mismatched BUY persists nothing
+  printf("bench STATS over %d cmds:", CYCLES * 4);
+  for (int p = 0; p < 5; p++)
+    printf(" %s %.0f%%", PHASES[p], sum[5] ? 100.0 * sum[p] / sum[5] : 0.0);
+  printf(" (total %.2f us/cmd, max %lu us)\n", (double)sum[5] / n[5], maxUs[5]);
+
+  // The reset variant started a new window; STATS itself is never counted.
+  stats = runCommand("STATS");
+  TEST_ASSERT_EQUAL_INT(3, sscanf(stats.c_str(), "STATS:uptime_s=%lu,cmds=%lu,errors=%lu", &uptime, &cmds, &errors));
+  TEST_ASSERT_EQUAL_UINT(0, cmds);
+
+  // Binary mode carries the same report as text in OP_STATS frames, then a DONE frame.
+  runCommand("BINARY");
+  uint8_t request[] = {1, 0x0A};
+  size_t wire = 0;
+  std::string frames = runFrame(request, sizeof(request), wire), text;
+  uint8_t lastStatus = 0xFF;
+  for (size_t start = 0, end; (end = frames.find('\0', start)) != std::string::npos; start = end + 1) {
+    uint8_t decoded[128];
+    memcpy(decoded, frames.data() + start, end - start);
+    uint8_t len = cobsDecode(decoded, end - start);
+    TEST_ASSERT_EQUAL_HEX8(0x8A, decoded[1]);
+    lastStatus = decoded[2];
+    if (lastStatus == 0) text.append(reinterpret_cast<char *>(decoded + 3), len - 5);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x0A, lastStatus);
+  TEST_ASSERT_EQUAL_STRING_LEN("STATS:", text.c_str(), 6);
+  TEST_ASSERT_TRUE(text.size() > 10 && text.compare(text.size() - 10, 10, "END_STATS\n") == 0);
+}
+
+// ----------------------------------------------------
+// Record log behaviour
+// ----------------------------------------------------
+// Boots the firmware again over the EEPROM as it stands.
+static void reboot() {
+  setup();
+  native::serialClearOutput();
+}
+
+static std::string keyCommand(const char *cmd, const char *id, const char *token) {
+  char line[96];
+  snprintf(line, sizeof(line), "%s:%s:%s", cmd, id, token);
+  return runCommand(line);
+}
+
+static bool listed(const char *id) {
+  char entry[24];
+  snprintf(entry, sizeof(entry), "  %s (", id);
+  return runCommand("LIST").find(entry) != std::string::npos;
+}
+
+static void assertRelease(const char *id, const char *purchase, const char *item) {
+  char expected[160];
+  snprintf(expected, sizeof(expected), "OK_RELEASE:%s:%s:%s", id, purchase, item);
+  assertReply(keyCommand("BUY", id, purchase), expected);
+}
+
+// Three auctions stay keyed while hundreds of others cycle through the log,
+// so every page is recycled many times with live records copied forward.
+void test_log_compaction_churn() {
+  char id[16];
+  for (int i = 0; i < 3; i++) {
+    auctionId(id, 900 + i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+    assertReply(keyCommand("ADD", id, TOKEN_B), "OK_ADD:");
+  }
+  for (int i = 0; i < 500; i++) {
+    auctionId(id, i);
+    assertReply(keyCommand("ITEM", id, TOKEN_B), "OK_ITEM:");
+    assertReply(keyCommand("ADD", id, TOKEN_A), "OK_ADD:");
+    assertRelease(id, TOKEN_A, TOKEN_B);
+  }
+
+  std::string stats = runCommand("STATS");
+  const char *at = strstr(stats.c_str(), "EEPROM:");
+  TEST_ASSERT_NOT_NULL(at);
+  int pages = 0;
+  for (char *end = const_cast<char *>(at) + 6; *end == ':' || *end == ','; pages++)
+    TEST_ASSERT_TRUE(strtoul(end + 1, &end, 10) > 0);                // every page was recycled
+  TEST_ASSERT_EQUAL_INT(NATIVE_EEPROM_SIZE / 128, pages);
+
+  reboot();
+  for (int i = 0; i < 3; i++) {
+    auctionId(id, 900 + i);
+    assertRelease(id, TOKEN_B, TOKEN_A);
+  }
+}
+
+// setup() over the same EEPROM rebuilds the index from the newest records.
+void test_log_rebuild_on_reboot() {
+  assertReply(keyCommand("ITEM", "A", TOKEN_A), "OK_ITEM:");
+  assertReply(keyCommand("ADD", "A", TOKEN_B), "OK_ADD:");
+  assertReply(keyCommand("ITEM", "B", TOKEN_A), "OK_ITEM:");
+  assertReply(keyCommand("ITEM", "C", TOKEN_A), "OK_ITEM:");
+  assertReply(keyCommand("ADD", "C", TOKEN_A), "OK_ADD:");
+  assertReply(keyCommand("ADD", "C", TOKEN_B), "OK_ADD:");
+  assertReply(runCommand("ERASE:B"), "OK_ERASE:B");
+
+  reboot();
+  TEST_ASSERT_FALSE(listed("B"));
+  assertReply(keyCommand("BUY", "B", TOKEN_A), "ERR_NO_ITEM");
+  assertReply(keyCommand("BUY", "C", TOKEN_A), "ERR_MISMATCH:C");
+  assertRelease("C", TOKEN_B, TOKEN_A);
+  assertRelease("A", TOKEN_B, TOKEN_A);
+}
+
+// Page sequence numbers are 16-bit; the chain must survive 0xFFFF -> 0.
+void test_log_sequence_wrap() {
+  loop();                                    // land page 0's header first
+  uint8_t *cells = native::eepromData();
+  cells[0] = 0xFE;
+  cells[1] = 0xFF;
+  reboot();
+
+  char id[16];
+  for (int i = 0; i < 4; i++) {             // one ITEM + ADD pair per page
+    auctionId(id, i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+    assertReply(keyCommand("ADD", id, TOKEN_B), "OK_ADD:");
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x00, cells[2 * 128]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, cells[2 * 128 + 1]);
+
+  reboot();
+  for (int i = 0; i < 4; i++) {
+    auctionId(id, i);
+    assertRelease(id, TOKEN_B, TOKEN_A);
+  }
+}
+
+// A record whose CRC never landed ends the page; the next append reuses its space.
+void test_log_torn_record() {
+  char first[16], second[16], third[16];
+  auctionId(first, 1);
+  auctionId(second, 2);
+  auctionId(third, 3);
+  assertReply(keyCommand("ITEM", first, TOKEN_A), "OK_ITEM:");
+  assertReply(keyCommand("ITEM", second, TOKEN_A), "OK_ITEM:");
+  uint16_t size = 4 + strlen(first) + 32;
+  native::eepromData()[3 + 2 * size - 1] ^= 0xFF;
+
+  reboot();
+  TEST_ASSERT_TRUE(listed(first));
+  TEST_ASSERT_FALSE(listed(second));
+  assertReply(keyCommand("ITEM", third, TOKEN_A), "OK_ITEM:");
+  reboot();
+  TEST_ASSERT_TRUE(listed(first));
+  TEST_ASSERT_TRUE(listed(third));
+}
+
+// A page whose magic byte never landed is ignored along with its records.
+void test_log_torn_page_header() {
+  char id[16];
+  for (int i = 0; i < 3; i++) {             // the third record opens page 1
+    auctionId(id, i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+  }
+  native::eepromData()[128 + 2] = 0x00;
+
+  reboot();
+  auctionId(id, 2);
+  TEST_ASSERT_FALSE(listed(id));
+  auctionId(id, 3);
+  assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+  reboot();
+  for (int i = 0; i < 4; i++) {
+    auctionId(id, i);
+    TEST_ASSERT_EQUAL(i != 2, listed(id));
+  }
+}
+
+struct CellWrite {
+  int idx;
+  uint8_t val;
+};
+
+static std::vector<CellWrite> cellWrites;
+
+static void recordCellWrite(int idx, uint8_t val) { cellWrites.push_back({idx, val}); }
+
+// Counts the auctions LIST shows; *other is set when one isn't `allowed`.
+static int listedAuctions(const char *allowed, bool *other) {
+  std::string list = runCommand("LIST");
+  int count = 0;
+  *other = false;
+  for (size_t at = list.find("\n  "); at != std::string::npos; at = list.find("\n  ", at + 1)) {
+    count++;
+    if (list.compare(at + 3, strlen(allowed), allowed) != 0) *other = true;
+  }
+  return count;
+}
+
+// Every auction is erased right after its ITEM, so the log keeps recycling
+// pages whose stale records still carry valid CRCs. A power cut after any
+// prefix of an ITEM's cell writes must leave either nothing or that auction,
+// never an erased one brought back to life.
+void test_log_power_cut_on_recycled_page() {
+  char id[16];
+  const int warmUp = NATIVE_EEPROM_SIZE / 16;      // 64 B per cycle: over 2 laps
+  for (int i = 0; i < warmUp; i++) {
+    auctionId(id, i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+    assertReply(runCommand((std::string("ERASE:") + id).c_str()), "OK_ERASE:");
+  }
+
+  static uint8_t before[NATIVE_EEPROM_SIZE], after[NATIVE_EEPROM_SIZE];
+  uint8_t *cells = native::eepromData();
+  for (int i = warmUp; i < warmUp + 20; i++) {
+    auctionId(id, i);
+    memcpy(before, cells, NATIVE_EEPROM_SIZE);
+    cellWrites.clear();
+    native::setEepromWriteHook(recordCellWrite);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+    native::setEepromWriteHook(nullptr);
+    memcpy(after, cells, NATIVE_EEPROM_SIZE);
+
+    for (size_t cut = 0; cut <= cellWrites.size(); cut++) {
+      memcpy(cells, before, NATIVE_EEPROM_SIZE);
+      for (size_t w = 0; w < cut; w++) cells[cellWrites[w].idx] = cellWrites[w].val;
+      reboot();
+      bool other;
+      int count = listedAuctions(id, &other);
+      TEST_ASSERT_FALSE(other);
+      TEST_ASSERT_TRUE(count <= 1);
+      if (cut == cellWrites.size()) TEST_ASSERT_EQUAL(1, count);
+    }
+
+    memcpy(cells, after, NATIVE_EEPROM_SIZE);
+    reboot();
+    assertReply(runCommand((std::string("ERASE:") + id).c_str()), "OK_ERASE:");
+  }
+}
+
+// Reads one numeric field of the INFO reply.
+static long infoField(const char *name) {
+  std::string info = runCommand("INFO");
+  std::string key = std::string(",") + name + "=";
+  size_t at = info.find(key);
+  TEST_ASSERT_TRUE(at != std::string::npos);
+  return strtol(info.c_str() + at + key.size(), nullptr, 10);
+}
+
+// The advertised slot count holds that many complete auctions at the longest
+// ID, through repeated fills and erases.
+void test_log_fill_to_capacity() {
+  long slots = infoField("slots");
+  TEST_ASSERT_EQUAL((2 * (NATIVE_EEPROM_SIZE / 128 - 1) - 1) / 2, slots);
+  char id[16];
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < slots; i++) {
+      snprintf(id, sizeof(id), "FILL%02d%06d", round, i);
+      TEST_ASSERT_EQUAL_UINT(12, strlen(id));
+      assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+      assertReply(keyCommand("ADD", id, TOKEN_B), "OK_ADD:");
+    }
+    assertReply(keyCommand("ITEM", "X", TOKEN_A), "ERR_FULL");
+    for (int i = 0; i < slots; i++) {
+      snprintf(id, sizeof(id), "FILL%02d%06d", round, i);
+      if (i % 2) assertRelease(id, TOKEN_B, TOKEN_A);
+      else assertReply(runCommand((std::string("ERASE:") + id).c_str()), "OK_ERASE:");
+    }
+  }
+  reboot();
+  TEST_ASSERT_EQUAL(slots, infoField("free"));
+}
+
+// At full capacity both keys of any auction can still be replaced, again and
+// again, with the superseded records reclaimed by compaction.
+void test_log_rekey_at_capacity() {
+  long slots = infoField("slots");
+  char id[24];
+  for (int i = 0; i < slots; i++) {
+    snprintf(id, sizeof(id), "REKEY%07d", i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+    assertReply(keyCommand("ADD", id, TOKEN_B), "OK_ADD:");
+  }
+  TEST_ASSERT_EQUAL(0, infoField("free"));
+  for (int round = 0; round < 100; round++) {
+    bool swapped = round % 2 == 0;
+    snprintf(id, sizeof(id), "REKEY%07d", (int)(round / 2 % slots));
+    assertReply(keyCommand("ADD", id, swapped ? TOKEN_A : TOKEN_B), "OK_ADD:");
+    assertReply(keyCommand("ITEM", id, swapped ? TOKEN_B : TOKEN_A), "OK_ITEM:");
+  }
+
+  reboot();
+  for (int i = 0; i < slots; i++) {
+    snprintf(id, sizeof(id), "REKEY%07d", i);
+    assertRelease(id, TOKEN_B, TOKEN_A);
+  }
+}
+
+// ----------------------------------------------------
+// INFO and RESERVE
+// ----------------------------------------------------
+// A reservation is logged, so it survives reboots and being copied forward
+// by compaction, and the keys that follow it land in the same slot.
+void test_reserve_persists() {
+  assertReply(runCommand("RESERVE:HELD"), "OK_RESERVE:HELD");
+  reboot();
+  TEST_ASSERT_EQUAL(1, infoField("used"));
+  TEST_ASSERT_TRUE(listed("HELD"));
+
+  char id[16];
+  for (int i = 0; i < 100; i++) {
+    auctionId(id, i);
+    assertReply(keyCommand("ITEM", id, TOKEN_B), "OK_ITEM:");
+    assertReply(keyCommand("ADD", id, TOKEN_A), "OK_ADD:");
+    assertRelease(id, TOKEN_A, TOKEN_B);
+  }
+  reboot();
+  TEST_ASSERT_EQUAL(1, infoField("used"));
+  assertReply(runCommand("RESERVE:HELD"), "OK_RESERVE:HELD");
+  assertReply(keyCommand("ITEM", "HELD", TOKEN_A), "OK_ITEM:");
+  assertReply(keyCommand("ADD", "HELD", TOKEN_B), "OK_ADD:");
+  TEST_ASSERT_EQUAL(1, infoField("used"));
+  assertRelease("HELD", TOKEN_B, TOKEN_A);
+}
+
+// Reservations hold log space for both keys: once free reaches zero nothing
+// new is taken, and every reserved auction can still be keyed.
+void test_reserve_when_full() {
+  long slots = infoField("slots");
+  char id[24];
+  for (int i = 0; i < slots; i++) {
+    snprintf(id, sizeof(id), "RESERVED%04d", i);
+    TEST_ASSERT_EQUAL(slots - i, infoField("free"));
+    assertReply(runCommand((std::string("RESERVE:") + id).c_str()), "OK_RESERVE:");
+  }
+  TEST_ASSERT_EQUAL(0, infoField("free"));
+  TEST_ASSERT_TRUE(infoField("log_free") < 2 * 48);
+  assertReply(runCommand("RESERVE:LATE"), "ERR_FULL");
+  assertReply(keyCommand("ITEM", "LATE", TOKEN_A), "ERR_FULL");
+
+  reboot();
+  TEST_ASSERT_EQUAL(0, infoField("free"));
+  for (int i = 0; i < slots; i++) {
+    snprintf(id, sizeof(id), "RESERVED%04d", i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+    assertReply(keyCommand("ADD", id, TOKEN_B), "OK_ADD:");
+  }
+  TEST_ASSERT_EQUAL(0, infoField("free"));
+  snprintf(id, sizeof(id), "RESERVED%04d", 0);
+  assertRelease(id, TOKEN_B, TOKEN_A);
+  TEST_ASSERT_EQUAL(1, infoField("free"));
+  assertReply(runCommand("RESERVE:LATE"), "OK_RESERVE:LATE");
+}
+
+// Short IDs commit less of the log, but free never exceeds the unused slots.
+void test_info_counts_log_space() {
+  long slots = infoField("slots");
+  TEST_ASSERT_EQUAL(slots, infoField("free"));
+  long capacity = (2 * (NATIVE_EEPROM_SIZE / 128 - 1) - 1) * 48;  // less one spare record
+  TEST_ASSERT_EQUAL(capacity, infoField("log_free"));
+  assertReply(keyCommand("ITEM", "A", TOKEN_A), "OK_ITEM:");
+  TEST_ASSERT_EQUAL(1, infoField("used"));
+  TEST_ASSERT_EQUAL(slots - 1, infoField("free"));
+  TEST_ASSERT_EQUAL(capacity - 2 * 37, infoField("log_free"));
+}
+
+// ----------------------------------------------------
+// Line parser
+// ----------------------------------------------------
+void test_parse_rejects_bad_lines() {
+  std::string badHex(TOKEN_A);
+  badHex[40] = 'G';
+  assertReply(keyCommand("ADD", "x", badHex.c_str()), "ERR_FORMAT");
+  assertReply(keyCommand("ADD", "x", TOKEN_A), "OK_ADD:x");   // the bad token stored nothing
+
+  // 97 bytes: one more than a line slot holds. The rest of the line is
+  // discarded with it, and the next line parses normally.
+  std::string longLine = "ITEM:x:" + std::string(TOKEN_A) + std::string(26, 'F');
+  TEST_ASSERT_EQUAL_UINT(97, longLine.size());
+  assertReply(runCommand(longLine.c_str()), "ERR_SYNTAX");
+  std::string release = "OK_RELEASE:x:" + std::string(TOKEN_A) + "\r\n";    // and no item key
+  TEST_ASSERT_EQUAL_STRING(release.c_str(), keyCommand("BUY", "x", TOKEN_A).c_str());
+}
+
+// IDs longer than a record holds are refused by every command, so a 13-char
+// ID can't open a second slot beside the 12-char one it would be cut to.
+void test_parse_rejects_long_ids() {
+  const char *longId = "AUCTION000001";
+  TEST_ASSERT_EQUAL_UINT(13, strlen(longId));
+  assertReply(keyCommand("ITEM", "AUCTION00000", TOKEN_A), "OK_ITEM:");
+  assertReply(keyCommand("ITEM", longId, TOKEN_A), "ERR_FORMAT");
+  assertReply(keyCommand("ADD", longId, TOKEN_B), "ERR_FORMAT");
+  assertReply(keyCommand("BUY", longId, TOKEN_B), "ERR_FORMAT");
+  assertReply(runCommand("ERASE:AUCTION000001"), "ERR_FORMAT");
+  assertReply(runCommand("RESERVE:AUCTION000001"), "ERR_FORMAT");
+  assertReply(keyCommand("ITEM", "", TOKEN_A), "ERR_FORMAT");
+  TEST_ASSERT_EQUAL(1, infoField("used"));
+  assertReply(keyCommand("BUY", "AUCTION00000", TOKEN_B), "ERR_NO_PURCHASE_KEY");
+}
+
+// ----------------------------------------------------
+// Serial rings
+// ----------------------------------------------------
+// Full-duplex wire for the TX sink: every second call moves one byte each
+// way, so a byte time spans two polls and the firmware sees a full TX ring.
+static std::string wireIn, wireOut;
+static bool wireTick;
+
+static void fullDuplexWire() {
+  wireTick = !wireTick;
+  if (!wireTick) return;
+  if (!wireIn.empty()) {
+    native::serialFeed(wireIn.data(), 1);
+    wireIn.erase(0, 1);
+  }
+  wireOut += native::serialTakeOutput(1);
+}
+
+// A LIST reply several times the TX ring keeps the firmware waiting on TX
+// while the next line, sent within the credit window, arrives behind it.
+void test_tx_stall_keeps_rx_flowing() {
+  char id[16];
+  for (int i = 0; i < 5; i++) {
+    auctionId(id, i);
+    assertReply(keyCommand("ITEM", id, TOKEN_A), "OK_ITEM:");
+  }
+  size_t dropped = native::serialDropped();
+  native::setSerialRxCapacity(64);
+  native::setSerialTxCapacity(64);
+  native::setSerialTxSink(fullDuplexWire);
+  wireIn = "LIST\n#0:ITEM:NEW:" + std::string(TOKEN_A) + "\n";
+  wireOut.clear();
+  for (int i = 0; i < 1000 && (!wireIn.empty() || native::serialOutputPending()); i++) {
+    fullDuplexWire();
+    loop();
+  }
+  native::setSerialTxSink(nullptr);
+  native::setSerialTxCapacity(0);
+  native::setSerialRxCapacity(0);
+
+  TEST_ASSERT_EQUAL_UINT(dropped, native::serialDropped());
+  TEST_ASSERT_NOT_NULL(strstr(wireOut.c_str(), "  AUC00000004 (item=Y"));
+  TEST_ASSERT_NOT_NULL(strstr(wireOut.c_str(), "ACK:0:1:"));
+  TEST_ASSERT_TRUE(listed("NEW"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(bench_compute_crc);
+  RUN_TEST(bench_hex_to_bytes);
+  RUN_TEST(bench_find_slot);
+  RUN_TEST(bench_command_cycle);
+  RUN_TEST(bench_key_sync_wire);
+  RUN_TEST(bench_pipelined_replay);
+  RUN_TEST(bench_stats_breakdown);
+  RUN_TEST(test_log_compaction_churn);
+  RUN_TEST(test_log_rebuild_on_reboot);
+  RUN_TEST(test_log_sequence_wrap);
+  RUN_TEST(test_log_torn_record);
+  RUN_TEST(test_log_torn_page_header);
+  RUN_TEST(test_log_power_cut_on_recycled_page);
+  RUN_TEST(test_log_fill_to_capacity);
+  RUN_TEST(test_log_rekey_at_capacity);
+  RUN_TEST(test_reserve_persists);
+  RUN_TEST(test_reserve_when_full);
+  RUN_TEST(test_info_counts_log_space);
+  RUN_TEST(test_parse_rejects_bad_lines);
+  RUN_TEST(test_parse_rejects_long_ids);
+  RUN_TEST(test_tx_stall_keeps_rx_flowing);
+  return UNITY_END();
+}
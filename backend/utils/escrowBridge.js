@@ -3,11 +3,21 @@
  * Streams purchase keys from the API to the Arduino over serial and reports release confirmations back.
  * Usage:
  *   ESCROW_SERIAL_PORT=COM5 ESCROW_API_BASE=http://localhost:5000 node utils/escrowBridge.js
+ * Set ESCROW_PROTOCOL=binary to switch the controller into COBS-framed binary mode after boot.
+ *
+ * Commands are tagged with a sequence number and pipelined inside the credit window the
+ * controller advertises (SYNC on connect, then batched ACK:<seq>:<count>:<limit> replies),
+ * so a whole poll's worth of keys goes out in one pass without overrunning its RX buffer.
+ * With ESCROW_STATS_MS set, the controller's STATS telemetry is scraped (and reset) on that
+ * interval and summarised in the log.
+ * When the controller answers ERR_FULL, polls stop pushing keys and ask for INFO instead
+ * until it reports room for another complete auction.
  *
  * Requires `serialport` and `axios` dependencies (install inside backend folder).
  */
 require('dotenv').config();
 const axios = require('axios');
+const { OP, STATUS, encodeFrame, idPayload, decodeReply } = require('./escrowFrames');
 
 let SerialPort;
 try {
@@ -28,28 +38,212 @@ const SERIAL_BAUD = Number(process.env.ESCROW_SERIAL_BAUD || 115200);
 const API_BASE = process.env.ESCROW_API_BASE || 'http://localhost:5000';
 const DEVICE_SECRET = process.env.ESCROW_DEVICE_SECRET || 'shadow-escrow-dev';
 const POLL_INTERVAL_MS = Number(process.env.ESCROW_POLL_MS || 4000);
+const USE_BINARY = (process.env.ESCROW_PROTOCOL || 'text').toLowerCase() === 'binary';
+const ACK_TIMEOUT_MS = Number(process.env.ESCROW_ACK_TIMEOUT_MS || 2000);
+const STATS_INTERVAL_MS = Number(process.env.ESCROW_STATS_MS || 0);
+const MAX_ATTEMPTS = 3;
+const BOOT_BANNER = '=== Escrow Verification Ready ===';
+const BOOT_BANNER_BYTES = Buffer.from(BOOT_BANNER);
 
 const port = new SerialPort({
   path: SERIAL_PATH,
   baudRate: SERIAL_BAUD
 });
 
-let readBuffer = '';
+let readBuffer = Buffer.alloc(0);
+let protocolState = 'text'; // 'text' | 'leaving' | 'negotiating' | 'binary'
 const inFlightItem = new Set();
 const inFlightPurchase = new Set();
 
+// Flow control state; see the SYNC/ACK notes in Louvre-Random/src/main.cpp.
+const sendQueue = []; // { op, auctionId, keys, onOk, onFail } waiting for credit
+const outstanding = new Map(); // seq -> command, in send order
+let linkReady = false; // credit limit known (or legacy firmware detected)
+let legacyLink = false; // firmware without SYNC: untagged, unwindowed writes
+let syncsPending = 0; // SYNCs sent but not yet answered; the window opens at zero
+let nextSeq = 0;
+let txLines = 0; // lines sent since the last SYNC, mod 256
+let creditLimit = 0;
+let lastProgressAt = Date.now();
+let statsQueued = false; // a STATS scrape is waiting in the queue or on the wire
+let statsText = null; // report being received, null between reports
+let deviceFull = false; // controller answered ERR_FULL; wait for INFO to show a free slot
+let infoQueued = false;
+
+function sendSync() {
+  syncsPending++;
+  lastProgressAt = Date.now();
+  port.write(protocolState === 'binary' ? encodeFrame(OP.SYNC) : 'SYNC\n');
+}
+
+// Key writes are idempotent, so an unconfirmed command is simply sent again; after
+// MAX_ATTEMPTS it is dropped and left for the next poll.
+function requeue(cmds) {
+  const retry = cmds.filter((cmd) => cmd.attempts < MAX_ATTEMPTS);
+  cmds.filter((cmd) => cmd.attempts >= MAX_ATTEMPTS).forEach((cmd) => cmd.onFail());
+  sendQueue.unshift(...retry);
+}
+
+// Called on connect and whenever the controller reboots: unacknowledged commands
+// are queued again and the window is re-learned.
+function restartLink() {
+  requeue([...outstanding.values()]);
+  outstanding.clear();
+  linkReady = false;
+  legacyLink = false;
+  syncsPending = 0;
+  lastProgressAt = Date.now();
+  statsText = null;
+  protocolState = 'text';
+  if (USE_BINARY) {
+    // A controller left in binary mode by an earlier session would take BINARY for a
+    // broken frame, so first end any partial frame and ask it to leave. A text-mode
+    // controller answers the same bytes with an error line instead.
+    protocolState = 'leaving';
+    port.write(Buffer.concat([Buffer.from([0]), encodeFrame(OP.TEXT), Buffer.from('\n')]));
+  } else {
+    sendSync();
+  }
+}
+
+function negotiateBinary() {
+  protocolState = 'negotiating';
+  lastProgressAt = Date.now();
+  port.write('BINARY\n');
+  console.log('➡️  BINARY');
+}
+
+function pump() {
+  while (linkReady && syncsPending === 0 && sendQueue.length > 0) {
+    if (!legacyLink && ((creditLimit - txLines) << 24) >> 24 <= 0) return;
+    const cmd = sendQueue.shift();
+    cmd.attempts = (cmd.attempts || 0) + 1;
+    let seq = null;
+    if (!legacyLink) {
+      seq = nextSeq;
+      nextSeq = (nextSeq + 1) & 0xff;
+      txLines = (txLines + 1) & 0xff;
+      outstanding.set(seq, cmd);
+    }
+    writeCommand(cmd, seq);
+  }
+}
+
+function writeCommand({ op, auctionId, keys }, seq) {
+  if (op === OP.INFO) {
+    port.write(protocolState === 'binary' ? encodeFrame(OP.INFO, Buffer.alloc(0), seq) : `${seq === null ? '' : `#${seq}:`}INFO\n`);
+    return;
+  }
+  if (op === OP.STATS) {
+    // The reset variant turns each scrape into the delta since the previous one.
+    port.write(
+      protocolState === 'binary' ? encodeFrame(OP.STATS, Buffer.from([1]), seq) : `${seq === null ? '' : `#${seq}:`}STATS:RESET\n`
+    );
+    return;
+  }
+  if (protocolState === 'binary') {
+    console.log(`➡️  [bin] #${seq} op=${op} ${auctionId}`);
+    port.write(encodeFrame(op, idPayload(auctionId, ...keys), seq));
+    return;
+  }
+  const verb = op === OP.ADD ? 'ADD' : 'ITEM';
+  const cmd = `${seq === null ? '' : `#${seq}:`}${verb}:${auctionId}:${keys[0].toUpperCase()}\n`;
+  console.log(`➡️  ${cmd.trim()}`);
+  port.write(cmd);
+}
+
+// Resolves every command up to lastSeq. If the controller saw fewer of them than we
+// sent, a line was lost on the wire and the unanswered ones are sent again.
+function resolveAck(lastSeq, count) {
+  lastProgressAt = Date.now();
+  if (count === 0 || !outstanding.has(lastSeq)) return;
+  const covered = [];
+  for (const [seq, cmd] of outstanding) {
+    covered.push(cmd);
+    outstanding.delete(seq);
+    if (seq === lastSeq) break;
+  }
+  const pending = covered.filter((cmd) => !cmd.failed);
+  if (covered.length === count) pending.forEach((cmd) => cmd.onOk());
+  else requeue(pending);
+}
+
+function handleAck({ seq, count, limit }, sync) {
+  if (sync && syncsPending === 0) return; // answer to a SYNC superseded by restartLink()
+  resolveAck(seq, count);
+  if (sync) {
+    syncsPending--;
+    if (syncsPending > 0) return; // only the newest SYNC restarts the line count
+    // Anything still outstanding was sent before SYNC yet never reached the controller.
+    requeue([...outstanding.values()]);
+    outstanding.clear();
+    linkReady = true;
+    txLines = 0;
+  }
+  creditLimit = limit;
+  pump();
+}
+
+function handleTaggedError(seq, reason) {
+  const cmd = outstanding.get(seq);
+  if (!cmd) return;
+  console.warn(`Controller rejected #${seq} (${cmd.auctionId}): ${reason}`);
+  if (reason === 'ERR_FULL' && !deviceFull) {
+    console.warn('Controller is out of slots; holding new keys until one frees up.');
+    deviceFull = true;
+  }
+  cmd.failed = true;
+  cmd.onFail();
+}
+
+// Stalled handshake or window (lost line or lost ACK): ask the controller where it is.
+setInterval(() => {
+  const handshake = protocolState === 'leaving' || protocolState === 'negotiating';
+  const waiting = handshake || syncsPending > 0 || outstanding.size > 0;
+  if (!waiting || Date.now() - lastProgressAt < ACK_TIMEOUT_MS) return;
+  console.warn('Controller stopped answering; resynchronising.');
+  if (handshake) {
+    restartLink();
+    return;
+  }
+  syncsPending = 0;
+  sendSync();
+}, ACK_TIMEOUT_MS);
+
 port.on('open', () => {
   console.log(`🔌 Serial bridge connected on ${SERIAL_PATH} @ ${SERIAL_BAUD} baud`);
+  restartLink();
 });
 
+// Text replies end in '\n'; once binary mode is on, COBS frames end in 0x00.
 port.on('data', (chunk) => {
-  readBuffer += chunk.toString();
-  let newlineIndex = readBuffer.indexOf('\n');
-  while (newlineIndex >= 0) {
-    const line = readBuffer.slice(0, newlineIndex).trim();
-    readBuffer = readBuffer.slice(newlineIndex + 1);
-    if (line) handleSerialLine(line);
-    newlineIndex = readBuffer.indexOf('\n');
+  readBuffer = Buffer.concat([readBuffer, chunk]);
+  if (protocolState === 'leaving') {
+    // Whichever answer comes back, the controller now reads text; drop the rest of it.
+    if (readBuffer.indexOf(0x00) < 0 && readBuffer.indexOf(0x0a) < 0) return;
+    readBuffer = Buffer.alloc(0);
+    negotiateBinary();
+    return;
+  }
+  if (protocolState === 'binary') {
+    // A rebooted controller is back in text mode and its banner never ends in 0x00.
+    const banner = readBuffer.indexOf(BOOT_BANNER_BYTES);
+    if (banner >= 0) {
+      readBuffer = readBuffer.subarray(banner + BOOT_BANNER_BYTES.length);
+      handleSerialLine(BOOT_BANNER);
+    }
+  }
+  let index = readBuffer.indexOf(protocolState === 'binary' ? 0x00 : 0x0a);
+  while (index >= 0) {
+    const unit = readBuffer.subarray(0, index);
+    readBuffer = readBuffer.subarray(index + 1);
+    if (protocolState === 'binary') {
+      if (unit.length) handleSerialFrame(unit);
+    } else {
+      const line = unit.toString().trim();
+      if (line) handleSerialLine(line);
+    }
+    index = readBuffer.indexOf(protocolState === 'binary' ? 0x00 : 0x0a);
   }
 });
 
@@ -57,52 +251,39 @@ port.on('error', (err) => {
   console.error('Serial port error:', err.message);
 });
 
-async function handleSerialLine(line) {
-  console.log(`🔁 ${line}`);
-
-  if (line.startsWith('OK_ITEM:')) {
-    const auctionId = line.replace('OK_ITEM:', '').trim();
-    if (!auctionId) return;
-    [...inFlightItem].forEach((key) => {
-      if (key.startsWith(`${auctionId}-`)) inFlightItem.delete(key);
-    });
-    try {
-      await axios.post(
-        `${API_BASE}/api/escrow/device/item-ack`,
-        { auctionId },
-        { headers: { 'x-escrow-secret': DEVICE_SECRET } }
-      );
-    } catch (error) {
-      console.error('Failed to ack item key sync:', error.message);
-    }
-    return;
+async function ackItem(auctionId) {
+  if (!auctionId) return;
+  [...inFlightItem].forEach((key) => {
+    if (key.startsWith(`${auctionId}-`)) inFlightItem.delete(key);
+  });
+  try {
+    await axios.post(
+      `${API_BASE}/api/escrow/device/item-ack`,
+      { auctionId },
+      { headers: { 'x-escrow-secret': DEVICE_SECRET } }
+    );
+  } catch (error) {
+    console.error('Failed to ack item key sync:', error.message);
   }
+}
 
-  if (line.startsWith('OK_ADD:')) {
-    const auctionId = line.replace('OK_ADD:', '').trim();
-    if (!auctionId) return;
-    inFlightPurchase.delete(auctionId);
-    try {
-      await axios.post(
-        `${API_BASE}/api/escrow/device/purchase-ack`,
-        { auctionId },
-        { headers: { 'x-escrow-secret': DEVICE_SECRET } }
-      );
-    } catch (error) {
-      console.error('Failed to ack purchase key sync:', error.message);
-    }
-    return;
+async function ackPurchase(auctionId) {
+  if (!auctionId) return;
+  inFlightPurchase.delete(auctionId);
+  try {
+    await axios.post(
+      `${API_BASE}/api/escrow/device/purchase-ack`,
+      { auctionId },
+      { headers: { 'x-escrow-secret': DEVICE_SECRET } }
+    );
+  } catch (error) {
+    console.error('Failed to ack purchase key sync:', error.message);
   }
+}
 
-  if (!line.startsWith('OK_RELEASE:')) return;
-
-  const payload = line.replace('OK_RELEASE:', '');
-  const parts = payload.split(':');
-  const auctionId = parts[0];
-  const purchaseKey = parts[1];
-  const itemKey = parts[2];
+async function confirmRelease(auctionId, purchaseKey, itemKey) {
   if (!auctionId || !purchaseKey) {
-    console.warn('Malformed OK_RELEASE line. Skipping.');
+    console.warn('Malformed OK_RELEASE reply. Skipping.');
     return;
   }
 
@@ -118,6 +299,227 @@ async function handleSerialLine(line) {
   }
 }
 
+// Parses a STATS report (see printStats() in Louvre-Random/src/main.cpp).
+function parseStats(text) {
+  const fields = (list) =>
+    Object.fromEntries(list.split(',').map((pair) => {
+      const [key, value] = pair.split('=');
+      return [key, key === 'hist' ? value.split('/').map(Number) : Number(value)];
+    }));
+  const stats = { phases: {}, eepromPageWrites: [] };
+  text.split('\n').forEach((raw) => {
+    const line = raw.trim().replace(/^#\d+:/, '');
+    const [section, ...rest] = line.split(':');
+    if (section === 'STATS') Object.assign(stats, fields(rest.join(':')));
+    else if (section === 'RX') stats.rx = fields(rest.join(':'));
+    else if (section === 'SRAM') stats.sram = fields(rest.join(':'));
+    else if (section === 'CMD') stats.commands = fields(rest.join(':'));
+    else if (section === 'PHASE') stats.phases[rest[0]] = fields(rest.slice(1).join(':'));
+    else if (section === 'EEPROM') stats.eepromPageWrites = rest.join(':').split(',').map(Number);
+  });
+  return stats;
+}
+
+function reportStats(text) {
+  const stats = parseStats(text);
+  const phases = Object.entries(stats.phases).filter(([name]) => name !== 'total');
+  const [slowest, phase] = phases.reduce((top, entry) => (entry[1].sum_us > top[1].sum_us ? entry : top), [
+    'none',
+    { sum_us: 0, n: 0, max_us: 0 }
+  ]);
+  const total = stats.phases.total || { sum_us: 0 };
+  const share = total.sum_us ? Math.round((100 * phase.sum_us) / total.sum_us) : 0;
+  console.log(
+    `📊 Controller: ${stats.cmds} cmds, ${stats.errors} errors; ${slowest} takes ${share}% of dispatch time ` +
+      `(avg ${phase.n ? Math.round(phase.sum_us / phase.n) : 0} us, max ${phase.max_us} us); ` +
+      `RX peak ${stats.rx?.serial_peak} B, SRAM low ${stats.sram?.low} B, ` +
+      `EEPROM writes ${stats.eepromPageWrites.reduce((a, b) => a + b, 0)} cells`
+  );
+}
+
+function scrapeStats() {
+  if (!linkReady || legacyLink || statsQueued) return;
+  statsQueued = true;
+  const done = () => {
+    statsQueued = false;
+  };
+  sendQueue.push({ op: OP.STATS, auctionId: 'STATS', keys: [], onOk: done, onFail: done });
+  pump();
+}
+
+if (STATS_INTERVAL_MS > 0) setInterval(scrapeStats, STATS_INTERVAL_MS);
+
+// INFO:id=<id>,slots=<n>,used=<n>,free=<n>,log_free=<bytes>,caps=<name>+...
+function parseInfo(line) {
+  const fields = Object.fromEntries(
+    line
+      .replace(/^(#\d+:)?INFO:/, '')
+      .split(',')
+      .map((pair) => pair.split('='))
+  );
+  return {
+    deviceId: fields.id,
+    slots: Number(fields.slots),
+    used: Number(fields.used),
+    free: Number(fields.free),
+    logFree: Number(fields.log_free)
+  };
+}
+
+function handleInfo(info) {
+  console.log(
+    `📟 Controller ${info.deviceId}: ${info.used}/${info.slots} slots used, room for ${info.free} more auctions, ` +
+      `${info.logFree} B log free`
+  );
+  // free counts auctions whose keys the log can still hold, not just unused slots
+  if (deviceFull && info.free > 0) {
+    deviceFull = false;
+    pollPending();
+  }
+}
+
+function requestInfo() {
+  if (!linkReady || legacyLink || infoQueued) return;
+  infoQueued = true;
+  const done = () => {
+    infoQueued = false;
+  };
+  // Firmware without INFO rejects it; fall back to retrying keys on every poll.
+  const unsupported = () => {
+    done();
+    deviceFull = false;
+  };
+  sendQueue.push({ op: OP.INFO, auctionId: 'INFO', keys: [], onOk: done, onFail: unsupported });
+  pump();
+}
+
+async function handleSerialLine(line) {
+  // STATS reports span several lines, from the (possibly tagged) header to END_STATS.
+  if (statsText !== null || /^(#\d+:)?STATS:/.test(line)) {
+    statsText = `${statsText || ''}${line}\n`;
+    if (line === 'END_STATS') {
+      reportStats(statsText);
+      statsText = null;
+    }
+    return;
+  }
+
+  console.log(`🔁 ${line}`);
+
+  if (/^(#\d+:)?INFO:/.test(line)) {
+    handleInfo(parseInfo(line));
+    return;
+  }
+
+  if (line === BOOT_BANNER) {
+    // A boot banner means the controller (re)started in text mode; replay right away.
+    restartLink();
+    pollPending();
+    return;
+  }
+
+  if (line === 'OK_BINARY') {
+    protocolState = 'binary';
+    port.write(Buffer.from([0])); // flush any partial frame on the controller side
+    sendSync();
+    return;
+  }
+
+  if (line === 'ERR_UNKNOWN_CMD:BINARY') {
+    console.warn('Controller firmware has no binary mode; staying on the text protocol.');
+    protocolState = 'text';
+    sendSync();
+    return;
+  }
+
+  if (line === 'ERR_UNKNOWN_CMD:SYNC') {
+    console.warn('Controller firmware has no flow control; sending commands unwindowed.');
+    syncsPending = 0;
+    linkReady = true;
+    legacyLink = true;
+    pump();
+    return;
+  }
+
+  const ack = line.match(/^(ACK|SYNC):(\d+):(\d+):(\d+)$/);
+  if (ack) {
+    handleAck({ seq: Number(ack[2]), count: Number(ack[3]), limit: Number(ack[4]) }, ack[1] === 'SYNC');
+    return;
+  }
+
+  const tagged = line.match(/^#(\d+):(.*)$/);
+  if (tagged) {
+    handleTaggedError(Number(tagged[1]), tagged[2]);
+    return;
+  }
+
+  if (line.startsWith('OK_ITEM:')) {
+    await ackItem(line.replace('OK_ITEM:', '').trim());
+    return;
+  }
+
+  if (line.startsWith('OK_ADD:')) {
+    await ackPurchase(line.replace('OK_ADD:', '').trim());
+    return;
+  }
+
+  if (!line.startsWith('OK_RELEASE:')) return;
+
+  const parts = line.replace('OK_RELEASE:', '').split(':');
+  await confirmRelease(parts[0], parts[1], parts[2]);
+}
+
+async function handleSerialFrame(frame) {
+  const reply = decodeReply(frame);
+  if (!reply) {
+    console.warn('Dropping malformed frame from controller.');
+    return;
+  }
+  if (reply.op === OP.STATS && (reply.status === STATUS.OK || reply.status === STATUS.DONE)) {
+    statsText = `${statsText || ''}${reply.text || ''}`;
+    if (reply.status === STATUS.DONE) {
+      reportStats(statsText);
+      statsText = null;
+    }
+    return;
+  }
+  console.log(`🔁 [bin] op=${reply.op} status=${reply.status} ${reply.auctionId || ''}`);
+  if (reply.ack) {
+    handleAck(reply.ack, reply.op === OP.SYNC);
+    return;
+  }
+  if (reply.seq !== null && reply.status !== STATUS.OK) {
+    handleTaggedError(reply.seq, Object.keys(STATUS).find((name) => STATUS[name] === reply.status) || `status ${reply.status}`);
+    return;
+  }
+  if (reply.status !== STATUS.OK) return;
+
+  switch (reply.op) {
+    case OP.ITEM:
+      await ackItem(reply.auctionId);
+      break;
+    case OP.ADD:
+      await ackPurchase(reply.auctionId);
+      break;
+    case OP.KEYS:
+      await Promise.all([ackItem(reply.auctionId), ackPurchase(reply.auctionId)]);
+      break;
+    case OP.BUY:
+      await confirmRelease(reply.auctionId, reply.tokens[0], reply.tokens[1]);
+      break;
+    case OP.INFO:
+      if (reply.info) handleInfo(reply.info);
+      break;
+    default:
+      break;
+  }
+}
+
+function sendKeys(op, auctionId, keys, onOk, onFail) {
+  sendQueue.push({ op, auctionId, keys, onOk, onFail });
+  pump();
+}
+
 async function pushPendingPurchases() {
   try {
     const response = await axios.get(`${API_BASE}/api/escrow/pending`, {
@@ -129,10 +531,13 @@ async function pushPendingPurchases() {
       if (inFlightPurchase.has(record.auctionId)) return;
       inFlightPurchase.add(record.auctionId);
       if (!record.purchaseKey) return;
-      const keyUpper = record.purchaseKey.toUpperCase();
-      const cmd = `ADD:${record.auctionId}:${keyUpper}\n`;
-      console.log(`➡️  ${cmd.trim()}`);
-      port.write(cmd);
+      sendKeys(
+        OP.ADD,
+        record.auctionId,
+        [record.purchaseKey],
+        () => ackPurchase(record.auctionId),
+        () => inFlightPurchase.delete(record.auctionId)
+      );
     });
   } catch (error) {
     console.error('Failed to fetch pending purchases:', error.message);
@@ -151,28 +556,48 @@ async function pushPendingItems() {
       if (inFlightItem.has(key)) return;
       inFlightItem.add(key);
       if (!record.itemKey) return;
-      const keyUpper = record.itemKey.toUpperCase();
-      const cmd = `ITEM:${record.auctionId}:${keyUpper}\n`;
-      console.log(`➡️  ${cmd.trim()}`);
-      port.write(cmd);
+
+      // In binary mode an unsynced purchase key rides along in the same KEYS frame.
+      const bundle = protocolState === 'binary' && record.purchaseKey && !record.purchaseSyncedAt &&
+        !inFlightPurchase.has(record.auctionId);
+      if (bundle) {
+        inFlightPurchase.add(record.auctionId);
+        sendKeys(
+          OP.KEYS,
+          record.auctionId,
+          [record.itemKey, record.purchaseKey],
+          () => Promise.all([ackItem(record.auctionId), ackPurchase(record.auctionId)]),
+          () => {
+            inFlightItem.delete(key);
+            inFlightPurchase.delete(record.auctionId);
+          }
+        );
+      } else {
+        sendKeys(OP.ITEM, record.auctionId, [record.itemKey], () => ackItem(record.auctionId), () => inFlightItem.delete(key));
+      }
     });
   } catch (error) {
     console.error('Failed to fetch pending item keys:', error.message);
   }
 }
 
-setInterval(() => {
-  pushPendingItems();
-  pushPendingPurchases();
-}, POLL_INTERVAL_MS);
+async function pollPending() {
+  if (deviceFull) {
+    requestInfo();
+    return;
+  }
+  await pushPendingItems();
+  await pushPendingPurchases();
+}
+
+setInterval(pollPending, POLL_INTERVAL_MS);
 
-pushPendingItems();
-pushPendingPurchases();
+pollPending();
 
 function resetDevice() {
   try {
     if (port && port.readable) {
-      port.write('RESET\n');
+      port.write(protocolState === 'binary' ? encodeFrame(OP.RESET) : 'RESET\n');
       console.log('♻️  Sent RESET command to escrow controller');
     }
   } catch (error) {
@@ -0,0 +1,176 @@
+/**
+ * Binary framing for the escrow controller (see BINARY mode in Louvre-Random/src/main.cpp).
+ * Frames are COBS-encoded and 0x00-terminated; decoded they read
+ *   [len][op][seq (if op & SEQ)][payload][crc16-ccitt, little endian]
+ * with len counting the bytes between itself and the CRC.
+ */
+const OP = {
+  ADD: 0x01,
+  ITEM: 0x02,
+  BUY: 0x03,
+  ERASE: 0x04,
+  LIST: 0x05,
+  RESET: 0x06,
+  KEYS: 0x07,
+  SYNC: 0x08,
+  ACK: 0x09,
+  STATS: 0x0a,
+  INFO: 0x0b,
+  RESERVE: 0x0c,
+  TEXT: 0x0f,
+  SEQ: 0x40,
+  REPLY: 0x80
+};
+
+const STATUS = {
+  OK: 0x00,
+  ERR_FORMAT: 0x01,
+  ERR_FULL: 0x02,
+  ERR_NO_ITEM: 0x03,
+  ERR_NO_PURCHASE_KEY: 0x04,
+  ERR_MISMATCH: 0x05,
+  ERR_NOT_FOUND: 0x06,
+  ERR_SYNTAX: 0x07,
+  ERR_UNKNOWN_CMD: 0x08,
+  ERR_CORRUPT: 0x09,
+  DONE: 0x0a
+};
+
+// Capability bits carried by an INFO reply.
+const CAP = {
+  SEQ: 0x01,
+  BINARY: 0x02,
+  STATS: 0x04,
+  RESERVE: 0x08
+};
+
+const TOKEN_BYTES = 32;
+
+function crc16(buf) {
+  let crc = 0xffff;
+  for (const byte of buf) {
+    crc ^= byte << 8;
+    for (let bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+    }
+  }
+  return crc;
+}
+
+function cobsEncode(buf) {
+  const out = [0];
+  let codeAt = 0;
+  let code = 1;
+  for (const byte of buf) {
+    if (byte === 0) {
+      out[codeAt] = code;
+      codeAt = out.length;
+      out.push(0);
+      code = 1;
+      continue;
+    }
+    out.push(byte);
+    if (++code === 0xff) {
+      out[codeAt] = code;
+      codeAt = out.length;
+      out.push(0);
+      code = 1;
+    }
+  }
+  out[codeAt] = code;
+  out.push(0);
+  return Buffer.from(out);
+}
+
+function cobsDecode(buf) {
+  const out = [];
+  let i = 0;
+  while (i < buf.length) {
+    const code = buf[i++];
+    if (code === 0 || i + code - 1 > buf.length) return null;
+    for (let j = 1; j < code; j++) out.push(buf[i++]);
+    if (code !== 0xff && i < buf.length) out.push(0);
+  }
+  return Buffer.from(out);
+}
+
+function encodeFrame(op, payload = Buffer.alloc(0), seq = null) {
+  const head = seq === null ? [payload.length + 1, op] : [payload.length + 2, op | OP.SEQ, seq];
+  const body = Buffer.concat([Buffer.from(head), payload]);
+  const crc = crc16(body);
+  return cobsEncode(Buffer.concat([body, Buffer.from([crc & 0xff, crc >> 8])]));
+}
+
+function idPayload(auctionId, ...tokensHex) {
+  const id = Buffer.from(String(auctionId), 'ascii');
+  return Buffer.concat([Buffer.from([id.length]), id, ...tokensHex.map((hex) => Buffer.from(hex, 'hex'))]);
+}
+
+/**
+ * Decodes one frame body (without the 0x00 delimiter).
+ * Returns { op, seq, status, auctionId, tokens: [hex...], flags, ack, text, info } or null if
+ * malformed; seq is null for untagged replies, ack is { seq, count, limit } for ACK/SYNC replies,
+ * text is the chunk of report carried by a STATS reply and info is
+ * { deviceId, slots, used, free, logFree, caps } for an INFO reply.
+ */
+function decodeReply(encoded) {
+  const frame = cobsDecode(encoded);
+  if (!frame || frame.length < 5 || frame[0] !== frame.length - 3) return null;
+  const crc = frame[frame.length - 2] | (frame[frame.length - 1] << 8);
+  if (crc16(frame.subarray(0, frame.length - 2)) !== crc) return null;
+
+  let offset = 2;
+  const seq = frame[1] & OP.SEQ ? frame[offset++] : null;
+  const reply = {
+    op: frame[1] & ~(OP.REPLY | OP.SEQ),
+    seq,
+    status: frame[offset++],
+    auctionId: null,
+    tokens: [],
+    flags: null,
+    ack: null,
+    text: null,
+    info: null
+  };
+  const payload = frame.subarray(offset, frame.length - 2);
+  if (reply.op === OP.ACK || reply.op === OP.SYNC) {
+    if (payload.length < 3) return null;
+    reply.ack = { seq: payload[0], count: payload[1], limit: payload[2] };
+  } else if (reply.op === OP.STATS && reply.status === STATUS.OK) {
+    reply.text = payload.toString('ascii');
+  } else if (reply.op === OP.INFO && reply.status === STATUS.OK) {
+    const idLen = payload[0];
+    if (payload.length < 1 + idLen + 9) return null;
+    const fields = payload.subarray(1 + idLen);
+    reply.info = {
+      deviceId: payload.subarray(1, 1 + idLen).toString('ascii'),
+      slots: fields.readUInt16LE(0),
+      used: fields.readUInt16LE(2),
+      free: fields.readUInt16LE(4),
+      logFree: fields.readUInt16LE(6),
+      caps: fields[8]
+    };
+  } else if (payload.length > 0) {
+    const idLen = payload[0];
+    reply.auctionId = payload.subarray(1, 1 + idLen).toString('ascii');
+    let offset = 1 + idLen;
+    while (payload.length - offset >= TOKEN_BYTES) {
+      reply.tokens.push(payload.subarray(offset, offset + TOKEN_BYTES).toString('hex').toUpperCase());
+      offset += TOKEN_BYTES;
+    }
+    if (offset < payload.length) reply.flags = payload[offset];
+  }
+  return reply;
+}
+
+module.exports = {
+  OP,
+  STATUS,
+  CAP,
+  crc16,
+  cobsEncode,
+  cobsDecode,
+  encodeFrame,
+  idPayload,
+  decodeReply
+};
@@ -1,5 +1,5 @@
-const crypto = require('crypto');
 const { db } = require('../config/database');
+const hardwareRng = require('./hardwareRng');
 
 const KEY_BYTES = 32; // 32 bytes -> 64 char hex strings (matches Arduino firmware)
 
@@ -8,7 +8,7 @@ function now() {
 }
 
 function generateKey(bytes = KEY_BYTES) {
-  return crypto.randomBytes(bytes).toString('hex');
+  return hardwareRng.randomBytes(bytes).toString('hex');
 }
 
 function findRecord(auctionId) {
@@ -0,0 +1,204 @@
+/**
+ * Load generator for the escrow controller (a board, or the env:emulator PTY build).
+ * Drives ITEM -> ADD -> BUY release cycles on fresh auction ids over the text protocol,
+ * pipelined with "#<seq>:" tags inside the credit window the controller advertises, then
+ * reports throughput, BUY release latency percentiles, error counts and the controller's
+ * own STATS report.
+ * Usage:
+ *   ESCROW_SERIAL_PORT=/tmp/escrow-tty node utils/escrowLoad.js [cycles]
+ *
+ * Release latency runs from writing a BUY to reading its OK_RELEASE, so it includes the
+ * time the line waits behind earlier commands on the wire and in the controller's inbox.
+ */
+require('dotenv').config();
+const crypto = require('crypto');
+
+let SerialPort;
+try {
+  // eslint-disable-next-line global-require
+  ({ SerialPort } = require('serialport'));
+} catch (error) {
+  console.error('serialport package not installed. Install it with `npm install serialport` inside backend/.');
+  process.exit(1);
+}
+
+const SERIAL_PATH = process.env.ESCROW_SERIAL_PORT || '/dev/ttyACM0';
+const SERIAL_BAUD = Number(process.env.ESCROW_SERIAL_BAUD || 115200);
+const ACK_TIMEOUT_MS = Number(process.env.ESCROW_ACK_TIMEOUT_MS || 2000);
+const CYCLES = Number(process.argv[2] || process.env.ESCROW_LOAD_CYCLES || 1000);
+const RUN_ID = crypto.randomBytes(2).toString('hex').toUpperCase();
+
+const port = new SerialPort({ path: SERIAL_PATH, baudRate: SERIAL_BAUD });
+
+const pending = []; // lines waiting for credit
+const outstanding = new Map(); // seq -> { kind, id, sentAt, done }
+const latencies = [];
+const errors = {};
+let nextSeq = 0;
+let txLines = 0;
+let creditLimit = 0;
+let synced = false;
+let startedAt = 0;
+let wireBytes = 0;
+let releases = 0;
+let lastProgressAt = Date.now();
+let readBuffer = '';
+let statsLines = null; // collecting the final STATS report
+
+function countError(reason, n = 1) {
+  errors[reason] = (errors[reason] || 0) + n;
+}
+
+function queueCycles() {
+  for (let i = 0; i < CYCLES; i++) {
+    const id = `L${RUN_ID}${i.toString(36).toUpperCase().padStart(7, '0')}`;
+    const itemKey = crypto.randomBytes(32).toString('hex').toUpperCase();
+    const purchaseKey = crypto.randomBytes(32).toString('hex').toUpperCase();
+    pending.push({ kind: 'ITEM', id, line: `ITEM:${id}:${itemKey}` });
+    pending.push({ kind: 'ADD', id, line: `ADD:${id}:${purchaseKey}` });
+    pending.push({ kind: 'BUY', id, line: `BUY:${id}:${purchaseKey}` });
+  }
+}
+
+function pump() {
+  while (synced && pending.length > 0 && ((creditLimit - txLines) << 24) >> 24 > 0) {
+    const cmd = pending.shift();
+    const seq = nextSeq;
+    nextSeq = (nextSeq + 1) & 0xff;
+    txLines = (txLines + 1) & 0xff;
+    const line = `#${seq}:${cmd.line}\n`;
+    wireBytes += line.length;
+    cmd.sentAt = process.hrtime.bigint();
+    outstanding.set(seq, cmd);
+    port.write(line);
+  }
+  if (synced && pending.length === 0 && outstanding.size === 0) finish();
+}
+
+function sync() {
+  synced = false;
+  lastProgressAt = Date.now();
+  port.write('SYNC\n');
+}
+
+// A cycle that did not release still holds a slot; erase it so a few lost lines don't
+// fill the controller and fail every later cycle with ERR_FULL.
+function cleanUp(id) {
+  pending.unshift({ kind: 'ERASE', id, line: `ERASE:${id}` });
+}
+
+// Everything up to lastSeq has been dispatched; a short count means lines were lost.
+function resolveAck(lastSeq, count) {
+  if (count === 0 || !outstanding.has(lastSeq)) return;
+  let covered = 0;
+  for (const [seq, cmd] of outstanding) {
+    covered++;
+    outstanding.delete(seq);
+    if (cmd.kind === 'BUY' && !cmd.done) {
+      countError('BUY without OK_RELEASE');
+      cleanUp(cmd.id);
+    }
+    if (seq === lastSeq) break;
+  }
+  if (covered > count) countError('lost line', covered - count);
+}
+
+function finish() {
+  if (statsLines) return;
+  const seconds = Number(process.hrtime.bigint() - startedAt) / 1e9;
+  const sorted = latencies.slice().sort((a, b) => a - b);
+  const pct = (p) => (sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor((p / 100) * sorted.length))] : 0);
+  const errorList = Object.entries(errors).map(([reason, n]) => `${reason}=${n}`).join(', ') || 'none';
+  console.log(
+    `${CYCLES} cycles (${CYCLES * 3} commands) in ${seconds.toFixed(1)} s: ${(releases / seconds).toFixed(1)} releases/s, ` +
+      `${((CYCLES * 3) / seconds).toFixed(1)} cmds/s, ${(wireBytes / seconds / 1024).toFixed(1)} KiB/s sent`
+  );
+  console.log(
+    `release latency p50 ${pct(50).toFixed(1)} ms, p99 ${pct(99).toFixed(1)} ms, ` +
+      `max ${(sorted[sorted.length - 1] || 0).toFixed(1)} ms over ${releases} releases`
+  );
+  console.log(`errors: ${errorList}`);
+  statsLines = [];
+  port.write('STATS\n');
+}
+
+function handleLine(line) {
+  lastProgressAt = Date.now();
+  if (statsLines) {
+    statsLines.push(line);
+    if (line === 'END_STATS') {
+      console.log(statsLines.join('\n'));
+      port.close();
+      process.exit(Object.keys(errors).length ? 1 : 0);
+    }
+    return;
+  }
+
+  const ack = line.match(/^(ACK|SYNC):(\d+):(\d+):(\d+)$/);
+  if (ack) {
+    resolveAck(Number(ack[2]), Number(ack[3]));
+    if (ack[1] === 'SYNC') {
+      // Whatever was still outstanding never reached the controller.
+      outstanding.forEach((cmd) => {
+        countError('lost line');
+        pending.unshift(cmd);
+      });
+      outstanding.clear();
+      txLines = 0;
+      synced = true;
+      if (!startedAt) startedAt = process.hrtime.bigint();
+    }
+    creditLimit = Number(ack[4]);
+    pump();
+    return;
+  }
+
+  const tagged = line.match(/^#(\d+):(.*)$/);
+  if (!tagged) {
+    if (line === '=== Escrow Verification Ready ===' && startedAt) {
+      countError('controller reboot');
+      sync();
+    }
+    return;
+  }
+  const cmd = outstanding.get(Number(tagged[1]));
+  if (!cmd) return;
+  if (cmd.kind === 'BUY' && tagged[2].startsWith('OK_RELEASE:')) {
+    cmd.done = true;
+    releases++;
+    latencies.push(Number(process.hrtime.bigint() - cmd.sentAt) / 1e6);
+  } else if (cmd.kind !== 'ERASE') {
+    cmd.done = true;
+    countError(tagged[2].split(':')[0]);
+    if (cmd.kind === 'BUY') cleanUp(cmd.id);
+  }
+}
+
+port.on('data', (chunk) => {
+  readBuffer += chunk.toString('latin1');
+  let index = readBuffer.indexOf('\n');
+  while (index >= 0) {
+    const line = readBuffer.slice(0, index).trim();
+    readBuffer = readBuffer.slice(index + 1);
+    if (line) handleLine(line);
+    index = readBuffer.indexOf('\n');
+  }
+});
+
+port.on('open', () => {
+  console.log(`Load test: ${CYCLES} ITEM/ADD/BUY cycles on ${SERIAL_PATH} @ ${SERIAL_BAUD} baud`);
+  queueCycles();
+  sync();
+});
+
+port.on('error', (err) => {
+  console.error('Serial port error:', err.message);
+  process.exit(2);
+});
+
+// A lost line or ACK stalls the window; resynchronise like the bridge does.
+setInterval(() => {
+  if (Date.now() - lastProgressAt < ACK_TIMEOUT_MS) return;
+  console.warn('Controller stopped answering; resynchronising.');
+  sync();
+}, ACK_TIMEOUT_MS);
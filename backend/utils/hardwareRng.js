@@ -0,0 +1,143 @@
+/**
+ * Client for the hardware_rng.ino sketch.
+ * Keeps a prefetched buffer of device randomness topped up with `GET <n>` bursts
+ * (reply: "RND:<n>\r\n" + n raw bytes + CRC32 little endian) so callers can take
+ * bytes synchronously. Disabled unless RNG_SERIAL_PORT is set.
+ */
+const crypto = require('crypto');
+
+const SERIAL_PATH = process.env.RNG_SERIAL_PORT;
+const SERIAL_BAUD = Number(process.env.RNG_SERIAL_BAUD || 115200);
+const BATCH_BYTES = Number(process.env.RNG_BATCH_BYTES || 4096);
+const LOW_WATER = BATCH_BYTES / 2;
+const REQUEST_TIMEOUT_MS = 5000;
+
+const CRC_TABLE = new Int32Array(256).map((_, n) => {
+  let c = n;
+  for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+  return c;
+});
+
+function crc32(buf) {
+  let crc = -1;
+  for (const byte of buf) crc = CRC_TABLE[(crc ^ byte) & 0xff] ^ (crc >>> 8);
+  return (crc ^ -1) >>> 0;
+}
+
+let port = null;
+let pool = Buffer.alloc(0);
+let rx = Buffer.alloc(0);
+let request = null; // { count, timer } while a GET is outstanding
+const stats = { batches: 0, bytes: 0, crcErrors: 0, healthFailures: 0, lastRateBps: 0 };
+
+function refill() {
+  if (!port || request || pool.length >= LOW_WATER) return;
+  rx = Buffer.alloc(0);
+  request = {
+    count: BATCH_BYTES,
+    startedAt: Date.now(),
+    timer: setTimeout(() => {
+      console.warn('Hardware RNG request timed out.');
+      request = null;
+    }, REQUEST_TIMEOUT_MS)
+  };
+  port.write(`GET ${BATCH_BYTES}\n`);
+}
+
+function noteHealthFailure() {
+  stats.healthFailures++;
+  console.warn('Hardware RNG reports an entropy source health failure.');
+}
+
+function onData(chunk) {
+  if (!request) {
+    // Health alarms arrive unsolicited; anything else between requests is a banner.
+    if (chunk.includes('HEALTH:FAIL')) noteHealthFailure();
+    return;
+  }
+  rx = Buffer.concat([rx, chunk]);
+  const header = rx.indexOf('\n');
+  if (header < 0) return;
+  const line = rx.subarray(0, header).toString().trim();
+  if (line.startsWith('ERR:')) {
+    // ERR:HEALTH means the source is failing its continuous tests; retry on the next draw.
+    clearTimeout(request.timer);
+    request = null;
+    rx = Buffer.alloc(0);
+    console.warn(`Hardware RNG refused the request (${line}); using OS randomness only.`);
+    return;
+  }
+  if (!line.startsWith('RND:')) {
+    if (line.startsWith('HEALTH:FAIL')) noteHealthFailure();
+    rx = rx.subarray(header + 1); // skip banner lines
+    onData(Buffer.alloc(0));
+    return;
+  }
+  const body = rx.subarray(header + 1);
+  if (body.length < request.count + 4) return;
+
+  const bytes = body.subarray(0, request.count);
+  const crc = body.readUInt32LE(request.count);
+  clearTimeout(request.timer);
+  const elapsed = Math.max(Date.now() - request.startedAt, 1);
+  request = null;
+  rx = Buffer.alloc(0);
+
+  if (crc32(bytes) !== crc) {
+    stats.crcErrors++;
+    console.warn('Hardware RNG batch failed its CRC32; discarded.');
+  } else {
+    pool = Buffer.concat([pool, bytes]);
+    stats.batches++;
+    stats.bytes += bytes.length;
+    stats.lastRateBps = Math.round((bytes.length * 1000) / elapsed);
+  }
+  refill();
+}
+
+function start() {
+  if (!SERIAL_PATH || port) return;
+  let SerialPort;
+  try {
+    // eslint-disable-next-line global-require
+    ({ SerialPort } = require('serialport'));
+  } catch (error) {
+    console.warn('serialport package not installed; hardware RNG disabled.');
+    return;
+  }
+  port = new SerialPort({ path: SERIAL_PATH, baudRate: SERIAL_BAUD });
+  port.on('data', onData);
+  port.on('open', () => {
+    console.log(`🎲 Hardware RNG connected on ${SERIAL_PATH} @ ${SERIAL_BAUD} baud`);
+    refill();
+  });
+  port.on('error', (err) => console.error('Hardware RNG serial error:', err.message));
+}
+
+/**
+ * Returns `bytes` random bytes: OS randomness XORed with device randomness when the
+ * prefetched pool has enough, so the result is never weaker than crypto.randomBytes.
+ */
+function randomBytes(bytes) {
+  const out = crypto.randomBytes(bytes);
+  if (pool.length >= bytes) {
+    const hw = pool.subarray(0, bytes);
+    for (let i = 0; i < bytes; i++) out[i] ^= hw[i];
+    hw.fill(0);
+    pool = pool.subarray(bytes);
+  }
+  refill();
+  return out;
+}
+
+function getStats() {
+  return { ...stats, pooled: pool.length, connected: Boolean(port && port.isOpen) };
+}
+
+start();
+
+module.exports = {
+  randomBytes,
+  getStats,
+  crc32
+};
@@ -1,89 +1,356 @@
 #include <Arduino.h>
+#include <string.h>
 /*
   Hardware RNG sketch for anonymous auction backend ingestion.
   - Samples floating analog pin A0 for true entropy (leave pin disconnected).
-  - Mixes successive analog readings with timer jitter via XOR and rotations.
-  - Emits 32-bit random integers plus CRC32 verification every 2 seconds over Serial.
+  - The ADC free-runs under interrupt (~9.6k samples/s); raw samples land in a
+    ring buffer and loop() folds them into a 32-byte entropy pool.
+  - A ChaCha20 DRBG is keyed from the pool and rekeyed every RESEED_SAMPLES
+    samples; each request ends with a fast-key-erasure rekey so earlier
+    output cannot be recovered from the state.
+  - Output is on demand: "GET <n>" answers "RND:<n>", then n raw bytes, then
+    the CRC32 of those bytes (4 bytes, little endian). "RAW <n>" returns
+    unconditioned samples in the same framing for offline entropy analysis.
+  - Every raw sample passes the SP 800-90B repetition count and adaptive
+    proportion tests. A failure is reported as "HEALTH:FAIL:<RCT|APT>", its
+    samples are not credited to the pool, and GET answers "ERR:HEALTH" until
+    a full APT window passes again.
 */
 
 const byte ANALOG_PIN = A0;
-const byte SAMPLE_ROUNDS = 32;
-const unsigned long OUTPUT_INTERVAL_MS = 2000UL;
+const unsigned long SERIAL_BAUD = 115200UL;  // GET is wire-bound; an Uno also runs 500000
+const uint16_t RESEED_SAMPLES = 512;        // raw samples mixed in between reseeds
+const uint16_t MAX_REQUEST = 65535;
 
-uint32_t generateRandom32();
-uint32_t crc32(uint32_t value);
-void printHex32(uint32_t value);
+// Health test cutoffs for a false-alarm rate of 2^-20 at an assumed min-entropy
+// of H = 1 bit per sample (SP 800-90B 4.4): RCT C = 1 + ceil(20 / H), APT C from
+// the W = 512 table.
+const byte RCT_CUTOFF = 21;
+const uint16_t APT_WINDOW = 512;
+const uint16_t APT_CUTOFF = 410;
+const byte LINE_SIZE = 16;
+
+#define SAMPLE_RING_SIZE 64                  // power of two
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+
+volatile uint8_t sampleRing[SAMPLE_RING_SIZE];
+volatile uint8_t sampleHead;                 // written by the sampler
+volatile uint8_t sampleTail;                 // read by collectEntropy()
+volatile uint16_t samplesDropped;            // ring was full
+
+uint8_t pool[32];
+uint8_t poolPos;
+uint16_t poolSamples;                        // samples mixed since the last reseed
+uint32_t totalSamples;
+uint32_t reseeds;
+
+uint8_t rctLast;
+byte rctRun;
+uint8_t aptReference;
+uint16_t aptMatches;
+uint16_t aptIndex;                           // 0 starts a new window
+bool sourceHealthy = false;                  // a full APT window has passed
+bool windowFailed;
+byte healthEvent;                            // pending HEALTH line, printed from loop()
+uint16_t rctFailures;
+uint16_t aptFailures;
+
+uint32_t drbgKey[8];
+uint32_t drbgCounter;
+bool drbgSeeded = false;
+
+char line[LINE_SIZE];
+byte lineLength;
+
+void startSampler();
+void collectEntropy();
+void reseed();
+void chachaBlock(const uint32_t key[8], uint32_t counter, uint32_t nonce, uint8_t out[64]);
+void drbgRekey();
+bool healthTest(uint8_t sample);
+bool waitForSource();
+void handleGet(uint32_t count);
+void handleRaw(uint32_t count);
+void printStatus();
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, uint8_t len);
 
 void setup() {
   pinMode(ANALOG_PIN, INPUT);            // ensure no pull-ups; pin must stay floating
-  Serial.begin(115200);
+  Serial.begin(SERIAL_BAUD);
+  startSampler();
   Serial.println(F("Arduino Hardware RNG Initialized"));
-  Serial.println(F("Format: millis | rnd=DEC | 0xHEX | crc32=0xHASH"));
+  Serial.println(F("Commands: GET <n> -> RND:<n> + n bytes + crc32 (LE) | STATUS"));
+  Serial.println(F("          RAW <n> -> RAW:<n> + n unconditioned samples + crc32 (LE)"));
 }
 
 void loop() {
-  uint32_t randomValue = generateRandom32();
-  uint32_t hash = crc32(randomValue);
-  unsigned long now = millis();
-
-  Serial.print(now);
-  Serial.print(F(" ms | rnd="));
-  Serial.print(randomValue);
-  Serial.print(F(" | 0x"));
-  printHex32(randomValue);
-  Serial.print(F(" | crc32=0x"));
-  printHex32(hash);
-  Serial.println();
-
-  delay(OUTPUT_INTERVAL_MS);
+  collectEntropy();
+  if (healthEvent) {
+    Serial.println(healthEvent == 'R' ? F("HEALTH:FAIL:RCT") : F("HEALTH:FAIL:APT"));
+    healthEvent = 0;
+  }
+
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (lineLength < LINE_SIZE - 1) line[lineLength++] = c;
+      continue;
+    }
+    line[lineLength] = '\0';
+    lineLength = 0;
+
+    bool get = strncmp(line, "GET ", 4) == 0;
+    if (get || strncmp(line, "RAW ", 4) == 0) {
+      uint32_t count = strtoul(line + 4, nullptr, 10);
+      if (count == 0 || count > MAX_REQUEST) Serial.println(F("ERR:RANGE"));
+      else if (get && !waitForSource()) Serial.println(F("ERR:HEALTH"));
+      else if (get) handleGet(count);
+      else handleRaw(count);
+    } else if (strcmp(line, "STATUS") == 0) {
+      printStatus();
+    } else if (line[0]) {
+      Serial.println(F("ERR:UNKNOWN"));
+    }
+  }
 }
 
-uint32_t generateRandom32() {
-  uint32_t entropy = 0;
+// ----------------------------------------------------
+// Sampler
+// ----------------------------------------------------
+void pushSample(uint8_t sample) {
+  uint8_t next = (sampleHead + 1) & SAMPLE_RING_MASK;
+  if (next == sampleTail) {
+    samplesDropped++;
+    return;
+  }
+  sampleRing[sampleHead] = sample;
+  sampleHead = next;
+}
 
-  for (uint8_t i = 0; i < SAMPLE_ROUNDS; ++i) {
-    uint16_t sample = analogRead(ANALOG_PIN);           // capture 10-bit analog noise
-    uint32_t jitter = micros();                         // micros jitter adds entropy
-    uint8_t shift = (i * 7) & 0x1F;                     // pseudo-random rotation amount
+#ifdef __AVR__
+// Free-running conversions on ANALOG_PIN, AVcc reference, ADC clock F_CPU/128
+// (13 cycles per conversion: ~9.6k samples/s at 16 MHz, slow enough for RAW to
+// stream every sample at 115200 baud). analogRead() must not be used while the
+// sampler owns the ADC.
+void startSampler() {
+  ADMUX = _BV(REFS0) | ((ANALOG_PIN - A0) & 0x07);
+  ADCSRB = 0;
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  ADCSRA |= _BV(ADSC);
+}
 
-    uint32_t mixed = ((uint32_t)sample << shift) ^
-                     (jitter >> ((shift ^ 0x0D) & 0x1F));
+ISR(ADC_vect) {
+  uint8_t low = ADCL;                     // ADCL must be read before ADCH
+  (void)ADCH;
+  pushSample(low);
+}
+#else
+// Host builds have no ADC interrupt; collectEntropy() polls analogRead() instead.
+void startSampler() {}
+#endif
 
-    entropy ^= mixed;                                   // mix sample via XOR
-    entropy = (entropy << 5) | (entropy >> 27);         // rotate left 5 bits
+// ----------------------------------------------------
+// Health tests
+// ----------------------------------------------------
+// Runs both continuous tests on one raw sample; false once the current APT
+// window has seen a failure. A failed window drops the pool's credit.
+bool healthTest(uint8_t sample) {
+  if (aptIndex == 0) {
+    aptReference = sample;
+    aptMatches = 1;
+    windowFailed = false;
+  } else if (sample == aptReference && ++aptMatches == APT_CUTOFF) {
+    ++aptFailures;
+    windowFailed = true;
+    healthEvent = 'A';
+  }
 
-    delayMicroseconds(150 + (jitter & 0x3F));           // decorrelate successive reads
+  // The run length saturates at the cutoff: a stuck source counts one failure
+  // and keeps every window it spans failed.
+  if (sample == rctLast) {
+    if (rctRun < RCT_CUTOFF && ++rctRun == RCT_CUTOFF) {
+      ++rctFailures;
+      healthEvent = 'R';
+    }
+    if (rctRun == RCT_CUTOFF) windowFailed = true;
+  } else {
+    rctLast = sample;
+    rctRun = 1;
+  }
+  if (++aptIndex == APT_WINDOW) {
+    aptIndex = 0;
+    sourceHealthy = !windowFailed;
+  }
+  if (windowFailed) {
+    sourceHealthy = false;
+    poolSamples = 0;
   }
+  return !windowFailed;
+}
+
+// Blocks through the first healthy window after boot; false once the source
+// has failed and not yet recovered.
+bool waitForSource() {
+  uint16_t failures = rctFailures + aptFailures;
+  while (!(sourceHealthy && drbgSeeded)) {
+    if (rctFailures + aptFailures != failures || (failures && !sourceHealthy)) return false;
+    collectEntropy();
+  }
+  return true;
+}
+
+// Folds raw samples into the pool; reseeds the DRBG once enough healthy ones
+// have arrived.
+void collectEntropy() {
+#ifndef __AVR__
+  for (uint8_t i = 0; i < SAMPLE_RING_SIZE / 2; ++i) pushSample(analogRead(ANALOG_PIN) & 0xFF);
+#endif
+  while (sampleTail != sampleHead) {
+    uint8_t sample = sampleRing[sampleTail];
+    sampleTail = (sampleTail + 1) & SAMPLE_RING_MASK;
+    ++totalSamples;
+    if (!healthTest(sample)) continue;
 
-  if (entropy == 0) {
-    entropy = micros() ^ analogRead(ANALOG_PIN);        // safety net if entropy stayed 0
+    uint8_t mixed = pool[poolPos];
+    pool[poolPos] = ((mixed << 3) | (mixed >> 5)) ^ sample;
+    poolPos = (poolPos + 1) & 31;
+    ++poolSamples;
+  }
+  if (poolSamples >= RESEED_SAMPLES) reseed();
+}
+
+// ----------------------------------------------------
+// ChaCha20 DRBG
+// ----------------------------------------------------
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTER(a, b, c, d) \
+  a += b; d ^= a; d = ROTL32(d, 16); \
+  c += d; b ^= c; b = ROTL32(b, 12); \
+  a += b; d ^= a; d = ROTL32(d, 8);  \
+  c += d; b ^= c; b = ROTL32(b, 7)
+
+void chachaBlock(const uint32_t key[8], uint32_t counter, uint32_t nonce, uint8_t out[64]) {
+  uint32_t x[16] = {0x61707865UL, 0x3320646EUL, 0x79622D32UL, 0x6B206574UL,
+                    key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+                    counter, nonce, 0, 0};
+  uint32_t s[16];
+  memcpy(s, x, sizeof(s));
+  for (uint8_t round = 0; round < 10; ++round) {
+    QUARTER(x[0], x[4], x[8], x[12]);
+    QUARTER(x[1], x[5], x[9], x[13]);
+    QUARTER(x[2], x[6], x[10], x[14]);
+    QUARTER(x[3], x[7], x[11], x[15]);
+    QUARTER(x[0], x[5], x[10], x[15]);
+    QUARTER(x[1], x[6], x[11], x[12]);
+    QUARTER(x[2], x[7], x[8], x[13]);
+    QUARTER(x[3], x[4], x[9], x[14]);
+  }
+  for (uint8_t i = 0; i < 16; ++i) {
+    uint32_t v = x[i] + s[i];
+    out[i * 4] = v;
+    out[i * 4 + 1] = v >> 8;
+    out[i * 4 + 2] = v >> 16;
+    out[i * 4 + 3] = v >> 24;
   }
+}
+
+// Replaces the key with the first half of a fresh block and wipes the block.
+void drbgRekey() {
+  uint8_t block[64];
+  chachaBlock(drbgKey, drbgCounter++, reseeds, block);
+  memcpy(drbgKey, block, sizeof(drbgKey));
+  memset(block, 0, sizeof(block));
+}
 
-  return entropy;
+// Conditions the pool through ChaCha20 keyed by (key ^ pool) and clears it.
+void reseed() {
+  uint8_t *key = reinterpret_cast<uint8_t *>(drbgKey);
+  for (uint8_t i = 0; i < 32; ++i) key[i] ^= pool[i];
+  memset(pool, 0, sizeof(pool));
+  poolSamples = 0;
+  ++reseeds;
+  drbgRekey();
+  drbgSeeded = true;
 }
 
-uint32_t crc32(uint32_t value) {
+// ----------------------------------------------------
+// Output
+// ----------------------------------------------------
+void handleGet(uint32_t count) {
+  Serial.print(F("RND:"));
+  Serial.println(count);
   uint32_t crc = 0xFFFFFFFFUL;
+  uint8_t block[64];
+  while (count > 0) {
+    uint8_t len = count < sizeof(block) ? count : sizeof(block);
+    chachaBlock(drbgKey, drbgCounter++, reseeds, block);
+    Serial.write(block, len);
+    crc = crc32Update(crc, block, len);
+    count -= len;
+    collectEntropy();                     // keep the sample ring drained while TX blocks
+  }
+  memset(block, 0, sizeof(block));
+  drbgRekey();
 
-  for (uint8_t byteIndex = 0; byteIndex < 4; ++byteIndex) {
-    uint8_t b = (value >> (byteIndex * 8)) & 0xFF;
-    crc ^= b;
-    for (uint8_t bit = 0; bit < 8; ++bit) {
-      if (crc & 1) {
-        crc = (crc >> 1) ^ 0xEDB88320UL;
-      } else {
-        crc >>= 1;
-      }
-    }
+  crc = ~crc;
+  uint8_t trailer[4] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24)};
+  Serial.write(trailer, sizeof(trailer));
+}
+
+// Streams unconditioned samples straight from the ring (pool and health state
+// are bypassed) so traces can be replayed by tools/rng_replay.
+void handleRaw(uint32_t count) {
+  Serial.print(F("RAW:"));
+  Serial.println(count);
+  uint32_t crc = 0xFFFFFFFFUL;
+  while (count > 0) {
+#ifndef __AVR__
+    pushSample(analogRead(ANALOG_PIN) & 0xFF);
+#endif
+    if (sampleTail == sampleHead) continue;
+    uint8_t sample = sampleRing[sampleTail];
+    sampleTail = (sampleTail + 1) & SAMPLE_RING_MASK;
+    Serial.write(sample);
+    crc = crc32Update(crc, &sample, 1);
+    --count;
   }
+  crc = ~crc;
+  uint8_t trailer[4] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24)};
+  Serial.write(trailer, sizeof(trailer));
+}
 
-  return ~crc;
+void printStatus() {
+  noInterrupts();
+  uint16_t dropped = samplesDropped;
+  interrupts();
+  Serial.print(F("STATUS:samples="));
+  Serial.print(totalSamples);
+  Serial.print(F(",dropped="));
+  Serial.print(dropped);
+  Serial.print(F(",reseeds="));
+  Serial.print(reseeds);
+  Serial.print(F(",healthy="));
+  Serial.print(sourceHealthy ? 1 : 0);
+  Serial.print(F(",rct_fail="));
+  Serial.print(rctFailures);
+  Serial.print(F(",apt_fail="));
+  Serial.println(aptFailures);
 }
 
-void printHex32(uint32_t value) {
-  for (int8_t shift = 28; shift >= 0; shift -= 4) {
-    uint8_t nibble = (value >> shift) & 0x0F;
-    char nibbleChar = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
-    Serial.print(nibbleChar);
+// Nibble-table CRC32 (IEEE 802.3, reflected): 64 bytes of flash, 2 lookups per byte.
+const uint32_t CRC32_NIBBLE[16] PROGMEM = {
+  0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+  0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+  0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+  0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+};
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, uint8_t len) {
+  for (uint8_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ pgm_read_dword(&CRC32_NIBBLE[crc & 0x0F]);
+    crc = (crc >> 4) ^ pgm_read_dword(&CRC32_NIBBLE[crc & 0x0F]);
   }
+  return crc;
 }
@@ -0,0 +1,159 @@
+/*
+  Host replay harness for hardware_rng.ino.
+  Feeds a recorded trace of raw samples through the sketch's own health tests,
+  pool mixing and DRBG reseeds, then reports SP 800-90B style min-entropy
+  estimates (most common value on the sample byte, Markov on its LSB) and the
+  samples processed per second.
+
+  Build from the repo root against the ArduinoNative stand-ins:
+    g++ -std=gnu++17 -O2 -DARDUINO_NATIVE_NO_MAIN -ILouvre-Random/lib/ArduinoNative/src \
+        tools/rng_replay.cpp Louvre-Random/lib/ArduinoNative/src/ArduinoNative.cpp -o rng_replay
+
+  Usage: rng_replay <trace>
+    - a "RAW <n>" capture from the sketch (RAW:<n> header, bytes, CRC32), or
+    - text with one "adc[,micros]" sample per line (traces of the old
+      generateRandom32 loop; the micros column is estimated separately), or
+    - any other file, read as one raw sample byte per byte.
+*/
+#include "../hardware_rng.ino"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<uint8_t> trace;
+size_t traceIndex;
+
+int traceSource(uint8_t) {
+  return trace[traceIndex++ % trace.size()];
+}
+
+bool readFile(const char *path, std::string &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.append(chunk, n);
+  fclose(f);
+  return true;
+}
+
+bool isTextTrace(const std::string &data) {
+  for (unsigned char c : data)
+    if (!isdigit(c) && c != ',' && c != '\n' && c != '\r' && c != ' ') return false;
+  return !data.empty();
+}
+
+// SP 800-90B 6.3.1: upper 99% bound on the most common value's probability.
+double mostCommonValue(const std::vector<uint8_t> &s) {
+  size_t counts[256] = {};
+  size_t top = 0;
+  for (uint8_t v : s)
+    if (++counts[v] > top) top = counts[v];
+  double n = (double)s.size();
+  double p = top / n;
+  double pu = fmin(1.0, p + 2.576 * sqrt(p * (1.0 - p) / (n - 1.0)));
+  return -log2(pu);
+}
+
+// SP 800-90B 6.3.3 on the least significant bit, per bit.
+double markovLsb(const std::vector<uint8_t> &s) {
+  double ones = 0, c[2][2] = {};
+  for (size_t i = 0; i < s.size(); i++) {
+    ones += s[i] & 1;
+    if (i) c[s[i - 1] & 1][s[i] & 1]++;
+  }
+  double p1 = ones / s.size(), p0 = 1.0 - p1;
+  double p00 = c[0][0] + c[0][1] ? c[0][0] / (c[0][0] + c[0][1]) : 0, p01 = 1.0 - p00;
+  double p11 = c[1][0] + c[1][1] ? c[1][1] / (c[1][0] + c[1][1]) : 0, p10 = 1.0 - p11;
+  double candidates[] = {
+    p0 * pow(p00, 127),                  // 000...
+    p0 * pow(p01, 64) * pow(p10, 63),    // 0101...
+    p0 * p01 * pow(p11, 126),            // 0111...
+    p1 * p10 * pow(p00, 126),            // 1000...
+    p1 * pow(p10, 64) * pow(p01, 63),    // 1010...
+    p1 * pow(p11, 127),                  // 111...
+  };
+  double pmax = 0;
+  for (double p : candidates) pmax = fmax(pmax, p);
+  return fmin(-log2(pmax) / 128.0, 1.0);
+}
+
+void reportEstimates(const char *label, const std::vector<uint8_t> &s) {
+  double mcv = mostCommonValue(s) + 0.0; // no "-0.000" for a constant trace
+  double markov = markovLsb(s) + 0.0;
+  printf("%-10s MCV %.3f bits/sample, Markov(LSB) %.3f bits/bit\n", label, mcv, markov);
+}
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+    return 2;
+  }
+  std::string data;
+  if (!readFile(argv[1], data)) {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 2;
+  }
+
+  std::vector<uint8_t> jitter;
+  if (data.compare(0, 4, "RAW:") == 0) {
+    size_t header = data.find('\n');
+    size_t count = strtoul(data.c_str() + 4, nullptr, 10);
+    if (header == std::string::npos || data.size() < header + 1 + count + 4) {
+      fprintf(stderr, "truncated RAW capture\n");
+      return 1;
+    }
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data.data()) + header + 1;
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < count; i++) crc = crc32Update(crc, bytes + i, 1);
+    uint32_t stored = bytes[count] | (bytes[count + 1] << 8) | (bytes[count + 2] << 16) | ((uint32_t)bytes[count + 3] << 24);
+    if (~crc != stored) {
+      fprintf(stderr, "RAW capture fails its CRC32\n");
+      return 1;
+    }
+    trace.assign(bytes, bytes + count);
+  } else if (isTextTrace(data)) {
+    size_t pos = 0;
+    while (pos < data.size()) {
+      size_t end = data.find('\n', pos);
+      if (end == std::string::npos) end = data.size();
+      std::string row = data.substr(pos, end - pos);
+      pos = end + 1;
+      if (row.find_first_of("0123456789") == std::string::npos) continue;
+      trace.push_back(strtoul(row.c_str(), nullptr, 10) & 0xFF);
+      size_t comma = row.find(',');
+      if (comma != std::string::npos) jitter.push_back(strtoul(row.c_str() + comma + 1, nullptr, 10) & 0xFF);
+    }
+  } else {
+    trace.assign(data.begin(), data.end());
+  }
+  if (trace.size() < 2) {
+    fprintf(stderr, "trace too short\n");
+    return 1;
+  }
+
+  // Replay through the sketch: collectEntropy() pulls 32 samples per call via
+  // analogRead(). Health results come from one pass over the trace; the trace
+  // then loops until there are enough samples to time.
+  native::setAnalogSource(traceSource);
+  auto start = std::chrono::steady_clock::now();
+  while (traceIndex + SAMPLE_RING_SIZE / 2 <= trace.size()) collectEntropy();
+  uint16_t rct = rctFailures, apt = aptFailures;
+  bool healthy = sourceHealthy;
+  uint32_t seeded = reseeds;
+  while (traceIndex < 1000000) collectEntropy();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("samples    %zu\n", trace.size());
+  reportEstimates("adc", trace);
+  if (!jitter.empty()) reportEstimates("micros", jitter);
+  printf("health     rct_fail=%u apt_fail=%u healthy=%d reseeds=%lu\n", rct, apt, healthy ? 1 : 0,
+         (unsigned long)seeded);
+  printf("throughput %.0f samples/s through health tests + pool\n", traceIndex / seconds);
+  return rct || apt ? 3 : 0;
+}